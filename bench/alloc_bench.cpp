@@ -0,0 +1,76 @@
+#include <iostream>
+#include <format>
+#include <string>
+#include <vector>
+#include <new>
+#include <cstdlib>
+#include "../inc/interpreter.hpp"
+#include "../inc/jit.hpp"
+
+/*
+    counts the heap allocations made while running a tight comparison loop, and fails if any are made per
+    iteration. the loop is run twice with different iteration counts, so the allocations made by lexing, parsing,
+    and setting up the engine cancel out, leaving only those made by the loop itself
+*/
+
+static size_t allocations {0};
+
+void* operator new(size_t size){
+    allocations++;
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {std::free(ptr);}
+void operator delete(void* ptr, size_t) noexcept {std::free(ptr);}
+
+// compares ints, chars, bools and strings, and indexes a string, on every iteration. this is constexpr so it can be
+// checked as a format string at compile time
+constexpr const char* COMPARISON_LOOP {
+    "set i 0\n"
+    "set s \"abc\"\n"
+    "loop:\n"
+    "set i add i 1\n"
+    "set a eq s \"abc\"\n"
+    "set b neq 'x' at s 0\n"
+    "set c and a b\n"
+    "set d gt i 5\n"
+    "set e not lte i 3\n"
+    "j< loop {} i\n"
+};
+
+// returns the number of allocations made running the loop for the given number of iterations
+static size_t count_allocations(ExecEngine engine, int iterations){
+    std::string source = std::format(COMPARISON_LOOP, iterations);
+    Interpreter machine;
+    machine.set_engine(engine);
+    size_t start = allocations;
+    machine.run_prog(source);
+    return allocations - start;
+}
+
+int main(){
+    struct Engine{
+        const char* name;
+        ExecEngine engine;
+    };
+    std::vector<Engine> engines {
+        {"loop", ExecEngine::ENGINE_LOOP},
+        {"threaded", ExecEngine::ENGINE_THREADED},
+        {"register", ExecEngine::ENGINE_REGISTER}
+    };
+    if (jit_supported())
+        engines.push_back({"jit", ExecEngine::ENGINE_JIT});
+    const int short_run {1000}, long_run {101000};
+    bool passed {true};
+    for (const Engine& engine : engines){
+        size_t short_count = count_allocations(engine.engine, short_run);
+        size_t long_count = count_allocations(engine.engine, long_run);
+        double per_iteration = (static_cast<double>(long_count) - static_cast<double>(short_count)) / (long_run - short_run);
+        std::cout << std::format("{:<10} {} allocations per iteration", engine.name, per_iteration) << std::endl;
+        if (long_count != short_count)
+            passed = false;
+    }
+    return passed ? 0 : 1;
+}
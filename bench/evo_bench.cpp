@@ -0,0 +1,282 @@
+#include <iostream>
+#include <sstream>
+#include <format>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <chrono>
+#include <limits>
+#include <stdexcept>
+#include <algorithm>
+#include "../inc/lexer.hpp"
+#include "../inc/parser.hpp"
+#include "../inc/interpreter.hpp"
+#include "../inc/source_file.hpp"
+#include "../inc/bytecode_file.hpp"
+
+/*
+    runs each workload in bench/workloads, feeding it the matching fixture in bench/fixtures as its input, with
+    every "$N" in the fixture replaced by the workload's problem size. the lexer, parser and engine are timed
+    separately, taking the fastest of several repeats, and the instructions run are counted in a separate run
+    of the program, so counting doesn't slow the timed runs
+*/
+
+#ifndef EVO_BENCH_DIR
+    #define EVO_BENCH_DIR "bench"
+#endif
+
+struct Workload{
+    std::string name;
+    size_t size;    // the default problem size, which is multiplied by the scale option
+};
+
+// the workloads, based on the examples that exercise each part of the interpreter
+const std::vector<Workload> WORKLOADS {
+    {"arith", 1000000},         // arithmetic loops
+    {"strings", 20000},         // string indexing with at and len, based on reverse.evo
+    {"recursion", 100000},      // recursive calls, based on factorial.evo
+    {"pow", 50000},             // calls and stack shuffling, based on pow.evo
+    {"vars", 500000},           // variable churn
+    {"fizzbuzz", 200000}        // print heavy output, based on fizzbuzz.evo
+};
+
+struct BenchOptions{
+    std::string dir {EVO_BENCH_DIR};
+    std::vector<std::string> names;
+    ExecEngine engine {ExecEngine::ENGINE_THREADED};
+    std::string engine_name {"threaded"};
+    double scale {1.0};
+    size_t repeat {3};
+    bool optimize {false};
+    bool json {false};
+};
+
+struct BenchResult{
+    std::string name;
+    size_t size {0};
+    double lex_ns {std::numeric_limits<double>::max()};
+    double parse_ns {std::numeric_limits<double>::max()};
+    double exec_ns {std::numeric_limits<double>::max()};
+    size_t ops_run {0};
+    std::string error;
+};
+
+// discards everything written to it, so print heavy workloads measure the interpreter rather than the terminal
+class NullBuffer : public std::streambuf{
+    protected:
+        int overflow(int chr) override {return chr;}
+        std::streamsize xsputn(const char*, std::streamsize count) override {return count;}
+};
+
+void print_usage(){
+    std::cout << "usage: evo_bench [options] [workload names]\n"
+              << "  --engine=<threaded|loop|jit|register>   the engine to run the workloads with (default threaded)\n"
+              << "  -O                                      fuses common instruction sequences into superinstructions\n"
+              << "  --scale=<x>                             multiplies every problem size by x (default 1)\n"
+              << "  --repeat=<n>                            times each phase n times, keeping the fastest (default 3)\n"
+              << "  --dir=<path>                            the directory holding the workloads and fixtures\n"
+              << "  --json                                  prints the results as JSON\n";
+}
+
+// parses the command line, throws an error for unrecognized options
+BenchOptions parse_options(int argc, char** argv){
+    BenchOptions options;
+    std::string arg;
+    for (int i = 1; i < argc; i++){
+        arg = argv[i];
+        if (arg.starts_with("--engine=")){
+            options.engine_name = arg.substr(9);
+            if (options.engine_name == "threaded")
+                options.engine = ExecEngine::ENGINE_THREADED;
+            else if (options.engine_name == "loop")
+                options.engine = ExecEngine::ENGINE_LOOP;
+            else if (options.engine_name == "jit")
+                options.engine = ExecEngine::ENGINE_JIT;
+            else if (options.engine_name == "register")
+                options.engine = ExecEngine::ENGINE_REGISTER;
+            else
+                throw std::runtime_error("Unknown engine \"" + options.engine_name + "\"");
+        }
+        else if (arg == "-O")
+            options.optimize = true;
+        else if (arg == "--json")
+            options.json = true;
+        else if (arg.starts_with("--dir="))
+            options.dir = arg.substr(6);
+        else if (arg.starts_with("--scale=") || arg.starts_with("--repeat=")){
+            try{
+                if (arg.starts_with("--scale="))
+                    options.scale = std::stod(arg.substr(8));
+                else
+                    options.repeat = std::stoul(arg.substr(9));
+            }
+            catch (const std::logic_error& e){
+                throw std::runtime_error("Invalid value for " + arg.substr(0, arg.find('=')));
+            }
+            if (options.scale <= 0 || options.repeat == 0)
+                throw std::runtime_error("Invalid value for " + arg.substr(0, arg.find('=')));
+        }
+        else if (arg == "--help"){
+            print_usage();
+            std::exit(0);
+        }
+        else if (arg.starts_with("-"))
+            throw std::runtime_error("Unrecognized option \"" + arg + "\"");
+        else
+            options.names.push_back(arg);
+    }
+    return options;
+}
+
+// returns the fixture's text with the problem size filled in
+std::string fill_fixture(std::string_view fixture, size_t size){
+    std::string input;
+    std::string size_str = std::to_string(size);
+    size_t start {0}, pos;
+    while ((pos = fixture.find("$N", start)) != fixture.npos){
+        input.append(fixture.substr(start, pos - start));
+        input.append(size_str);
+        start = pos + 2;
+    }
+    input.append(fixture.substr(start));
+    return input;
+}
+
+// runs a compiled program with the given input, discarding its output, returns the number of instructions run if counting
+size_t run_program(const CompiledProgram& program, const std::string& input, const BenchOptions& options, bool count){
+    std::istringstream in(input);
+    NullBuffer null_buffer;
+    std::streambuf* cin_buffer = std::cin.rdbuf(in.rdbuf());
+    std::streambuf* cout_buffer = std::cout.rdbuf(&null_buffer);
+    Interpreter machine;
+    machine.set_engine(options.engine);
+    machine.set_stats(count);
+    try{
+        machine.run_compiled(program);
+    }
+    catch (...){
+        std::cin.rdbuf(cin_buffer);
+        std::cout.rdbuf(cout_buffer);
+        throw;
+    }
+    std::cin.rdbuf(cin_buffer);
+    std::cout.rdbuf(cout_buffer);
+    return machine.stats().instructions;
+}
+
+BenchResult run_workload(const Workload& workload, const BenchOptions& options){
+    using Clock = std::chrono::steady_clock;
+    auto elapsed_ns = [](Clock::time_point start){
+        return std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    };
+    BenchResult result;
+    result.name = workload.name;
+    result.size = static_cast<size_t>(workload.size * options.scale);
+    SourceFile source(options.dir + "/workloads/" + workload.name + ".evo");
+    SourceFile fixture(options.dir + "/fixtures/" + workload.name + ".in");
+    std::string input = fill_fixture(fixture.text(), result.size);
+    CompiledProgram program;
+    try{
+        for (size_t i = 0; i < options.repeat; i++){
+            Clock::time_point start = Clock::now();
+            TokenizedProgram tokens = tokenize_program(source.text());
+            result.lex_ns = std::min(result.lex_ns, elapsed_ns(start));
+            Parser parser;
+            parser.set_optimize(options.optimize);
+            start = Clock::now();
+            program.instructions = parser.parse_program(tokens);
+            result.parse_ns = std::min(result.parse_ns, elapsed_ns(start));
+            program.var_names = parser.var_names();
+        }
+        for (size_t i = 0; i < options.repeat; i++){
+            Clock::time_point start = Clock::now();
+            run_program(program, input, options, false);
+            result.exec_ns = std::min(result.exec_ns, elapsed_ns(start));
+        }
+        result.ops_run = run_program(program, input, options, true);
+    }
+    catch (const std::runtime_error& e){
+        result.error = e.what();
+    }
+    return result;
+}
+
+// escapes a string for use in JSON
+std::string json_string(std::string_view str){
+    std::string out {"\""};
+    for (char chr : str){
+        if (chr == '"' || chr == '\\')
+            out.push_back('\\');
+        if (static_cast<unsigned char>(chr) < 0x20)
+            out.append(std::format("\\u{:04x}", static_cast<int>(chr)));
+        else
+            out.push_back(chr);
+    }
+    out.push_back('"');
+    return out;
+}
+
+void print_json(const std::vector<BenchResult>& results, const BenchOptions& options){
+    std::cout << "{\n";
+    std::cout << std::format("  \"engine\": {},\n", json_string(options.engine_name));
+    std::cout << std::format("  \"optimize\": {},\n", options.optimize ? "true" : "false");
+    std::cout << std::format("  \"repeat\": {},\n", options.repeat);
+    std::cout << "  \"workloads\": [\n";
+    for (size_t i = 0; i < results.size(); i++){
+        const BenchResult& result = results[i];
+        std::cout << std::format("    {{\"name\": {}, \"size\": {}, ", json_string(result.name), result.size);
+        if (!result.error.empty())
+            std::cout << std::format("\"error\": {}}}", json_string(result.error));
+        else{
+            double per_op = result.ops_run ? result.exec_ns / result.ops_run : 0.0;
+            std::cout << std::format("\"lex_ns\": {:.0f}, \"parse_ns\": {:.0f}, \"exec_ns\": {:.0f}, \"instructions\": {}, \"ns_per_instruction\": {:.3f}}}",
+                                     result.lex_ns, result.parse_ns, result.exec_ns, result.ops_run, per_op);
+        }
+        std::cout << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    std::cout << "  ]\n}" << std::endl;
+}
+
+void print_table(const std::vector<BenchResult>& results){
+    std::cout << std::format("{:<12}{:>10}{:>12}{:>12}{:>14}{:>14}{:>10}", "workload", "size", "lex ms", "parse ms", "exec ms", "instructions", "ns/inst") << std::endl;
+    for (const BenchResult& result : results){
+        if (!result.error.empty()){
+            std::cout << std::format("{:<12}{:>10}  error: {}", result.name, result.size, result.error) << std::endl;
+            continue;
+        }
+        double per_op = result.ops_run ? result.exec_ns / result.ops_run : 0.0;
+        std::cout << std::format("{:<12}{:>10}{:>12.3f}{:>12.3f}{:>14.3f}{:>14}{:>10.2f}", result.name, result.size,
+                                 result.lex_ns / 1e6, result.parse_ns / 1e6, result.exec_ns / 1e6, result.ops_run, per_op) << std::endl;
+    }
+}
+
+int main(int argc, char** argv){
+    BenchOptions options;
+    try{
+        options = parse_options(argc, argv);
+    }
+    catch (const std::runtime_error& e){
+        std::cerr << "evo_bench: " << e.what() << std::endl;
+        print_usage();
+        return 1;
+    }
+    std::vector<BenchResult> results;
+    bool failed {false};
+    for (const Workload& workload : WORKLOADS){
+        if (!options.names.empty() && std::find(options.names.begin(), options.names.end(), workload.name) == options.names.end())
+            continue;
+        try{
+            results.push_back(run_workload(workload, options));
+        }
+        catch (const std::runtime_error& e){
+            std::cerr << "evo_bench: " << workload.name << ": " << e.what() << std::endl;
+            return 1;
+        }
+        failed |= !results.back().error.empty();
+    }
+    if (options.json)
+        print_json(results, options);
+    else
+        print_table(results);
+    return failed ? 1 : 0;
+}
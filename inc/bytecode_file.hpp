@@ -0,0 +1,42 @@
+#ifndef BYTECODE_FILE_H
+#define BYTECODE_FILE_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include "../inc/instruction.hpp"
+
+/*
+    compiled programs are saved as .evoc files, which hold a program's parsed instructions, so running them skips
+    lexing and parsing. a file is a header, followed by the instructions, then a pool of every distinct argument
+    value, then the names of the program's variables, then its labels, then its line table, then the bytes of every
+    string. jumps are already resolved to instruction addresses, the labels and lines are only kept so errors and
+    profiles can name the code they come from.
+    numbers are stored in the byte order of the machine that wrote the file, and the version is bumped whenever
+    the layout or the op codes change, so stale files are rejected rather than misread
+*/
+
+const uint32_t EVOC_VERSION {4};
+
+// a parsed program, ready to be run or saved
+struct CompiledProgram{
+    std::vector<Instruction> instructions;
+    std::vector<std::string> var_names;
+    std::vector<ProgramLabel> labels;   // sorted by address
+    std::vector<LineEntry> lines;
+    uint64_t source_hash {0};   // the hash of the source the program was compiled from, see hash_source
+};
+
+// hashes a program's source along with everything else that changes the compiled program
+uint64_t hash_source(std::string_view source, bool optimize);
+// serializes a compiled program to the .evoc format
+std::string serialize_program(const CompiledProgram& program);
+// loads a program from the bytes of a .evoc file, throwing an error if they aren't a valid program
+CompiledProgram load_program(std::string_view bytes);
+// writes a compiled program to a .evoc file, replacing it atomically, returns false if it couldn't be written
+bool save_program(const CompiledProgram& program, const std::string& path);
+// returns the path a program with the given source hash is cached at, or an empty string if there's no cache directory
+std::string cache_path(uint64_t source_hash);
+
+#endif
@@ -2,6 +2,10 @@
 #define INSTRUCTION_H
 
 #include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
 #include "../inc/value.hpp"
 
 enum class InstructionType{
@@ -38,20 +42,92 @@ enum class InstructionType{
     INST_PRINTLN,
     INST_READ,
     INST_READINT,
+    INST_FLUSH,
     INST_AT,
     INST_LEN,
     INST_TYPE,
     INST_CONVERT,
-    INST_COND
+    INST_COND,
+    // superinstructions, these are only produced by the parser's optimization pass
+    INST_JUMP_NEQ,
+    INST_JUMP_EQ,
+    INST_JUMP_LESS,
+    INST_JUMP_GREATER,
+    INST_JUMP_LESS_EQ,
+    INST_JUMP_GREATER_EQ,
+    INST_INC_VAR,
+    INST_ADD_IMM,
+    INST_PRINT_POP,
+    INST_PRINTLN_POP,
+    // quickened instructions, these are only produced by the threaded engine as it runs, see quickened_op
+    INST_ADD_INT,
+    INST_SUB_INT,
+    INST_MUL_INT,
+    INST_DIV_INT,
+    INST_MOD_INT,
+    INST_ADD_FLOAT,
+    INST_SUB_FLOAT,
+    INST_MUL_FLOAT,
+    INST_DIV_FLOAT,
+    INST_NEQ_INT,
+    INST_EQ_INT,
+    INST_LESS_INT,
+    INST_GREATER_INT,
+    INST_LESS_EQ_INT,
+    INST_GREATER_EQ_INT,
+    INST_NEQ_CHAR,
+    INST_EQ_CHAR,
+    INST_JUMP_NEQ_INT,
+    INST_JUMP_EQ_INT,
+    INST_JUMP_LESS_INT,
+    INST_JUMP_GREATER_INT,
+    INST_JUMP_LESS_EQ_INT,
+    INST_JUMP_GREATER_EQ_INT,
+    INST_COUNT      // the number of op codes, not a real instruction
 };
 
 struct Instruction{
     InstructionType op_code;
     std::optional<Value> arg;
+    int aux {0};    // a second operand, used by superinstructions that need one
+    bool verified {false};  // set by the verifier when the instruction's stack and type checks can be skipped
+    bool generic {false};   // set when a quickened instruction's operands stop matching, so it isn't quickened again
     Instruction() : op_code(InstructionType::INST_NULL) {};
     Instruction(InstructionType op_code);
     Instruction(InstructionType op_code, const Value& arg);
+    Instruction(InstructionType op_code, const Value& arg, int aux);
     void set_arg(const Value& new_arg) {this->arg = new_arg;}
 };
 
+// a label, and the address of the instruction it marks
+struct ProgramLabel{
+    std::string name;
+    size_t address;
+};
+
+// returns the last label at or before an address, or nullptr if the address comes before every label, the labels must be sorted by address
+const ProgramLabel* label_of(const std::vector<ProgramLabel>& labels, size_t address);
+
+/*
+    an entry in a program's line table, which maps instructions back to the source lines they were parsed from.
+    each entry marks the first instruction of a line, and covers every instruction up to the next entry, so the
+    table has at most one entry per line, and is kept apart from the instructions so running them never touches it
+*/
+struct LineEntry{
+    uint32_t address;
+    uint32_t line;
+};
+
+// returns the source line of the instruction at an address, or 0 if it isn't known
+size_t line_of(const std::vector<LineEntry>& lines, size_t address);
+
+// returns true if the instruction's argument is the address of another instruction
+bool is_jump(InstructionType op_code);
+// returns the op code specialized for the given operand types, or the op code itself if there isn't one
+InstructionType quickened_op(InstructionType op_code, ValueType left, ValueType right);
+// returns the generic op code a quickened op code was specialized from
+InstructionType generic_op(InstructionType op_code);
+// returns the name of an op code, as shown in profiles and traces
+std::string_view op_name(InstructionType op_code);
+
 #endif
\ No newline at end of file
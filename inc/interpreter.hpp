@@ -3,46 +3,209 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <unordered_map>
+#include <array>
+#include <utility>
+#include <exception>
+#include <algorithm>
+#include <ostream>
+#include <cstdint>
 #include "../inc/parser.hpp"
 #include "../inc/value.hpp"
+#include "../inc/value_stack.hpp"
 #include "../inc/instruction.hpp"
+#include "../inc/jit.hpp"
+#include "../inc/register_vm.hpp"
+#include "../inc/bytecode_file.hpp"
+#include "../inc/profiler.hpp"
+#include "../inc/trace.hpp"
+#include "../inc/output_buffer.hpp"
+
+// the available bytecode execution engines
+enum class ExecEngine{
+    ENGINE_LOOP,        // the original fetch-and-switch loop
+    ENGINE_THREADED,    // direct threaded dispatch, one handler per op code
+    ENGINE_JIT,         // compiles hot loops to native code, running everything else one instruction at a time
+    ENGINE_REGISTER     // translates the program to register code, falling back to the threaded engine if it can't be
+};
+
+// the default limit on the number of values on the stack
+const size_t DEFAULT_MAX_STACK {65536};
+// the largest stack limit accepted on the command line, the whole stack is allocated up front so this keeps it to 4GB
+const size_t MAX_STACK_LIMIT {size_t(1) << 28};
+// returned by current_op when the interpreter isn't running any instruction
+const size_t NOT_RUNNING {static_cast<size_t>(-1)};
+
+// what an interpreter has run, and what it took. the instructions and the peak stack depth are only counted while stats are collected
+struct InterpreterStats{
+    uint64_t instructions {0};
+    size_t peak_stack {0};
+    size_t peak_calls {0};
+    size_t variables {0};
+    size_t live_variables {0};      // the variables that have been set
+    uint64_t string_bytes {0};      // the bytes of every string created while running
+    uint64_t lex_ns {0};
+    uint64_t parse_ns {0};
+    uint64_t exec_ns {0};
+};
 
 class Interpreter{
     private:
-        std::vector<Value> _stack;
+        ValueStack _stack;
         std::vector<Instruction> _instructions;
-        std::unordered_map<std::string, Value> _vars;
+        std::vector<Value> _vars;
         Parser _parser;
-        size_t _line_no {0};
+        OutputBuffer _output {std::cout, default_flush_policy()};
+        ExecEngine _engine {ExecEngine::ENGINE_THREADED};
+        bool _verify {true};
+        bool _collect_stats {false};
+        InterpreterStats _stats;
+        bool _profile {false};
+        Profiler _profiler;
+        std::vector<ProgramLabel> _labels;
+        TraceWriter* _trace {nullptr};
         size_t _next_op {0};
+        size_t _resume_op {0};      // the first instruction the shell hasn't run yet
+        ParserMark _pending_mark {};    // what had been parsed before the first expression still waiting on a label
         std::vector<size_t> _return_addrs;
+        std::exception_ptr _jit_error;
+        // register code doesn't keep the next op up to date, so it keeps its own program counter where errors can find it
+        const RegisterProgram* _reg_program {nullptr};
+        size_t _reg_pc {0};
+        bool _executing {false};
+        size_t _op_address() const;
+        size_t _current_line() const {return line_of(this->_parser.lines(), this->_op_address());}
         size_t _pop_return();
         void _push_return(size_t );
+        void _check_overflow();
+        void _load_vars();
+        void _execute();
+        void _run_engine();
+        template <bool STATS = false, bool PROFILE = false>
         void _run_bytecode();
+        template <bool STATS = false, bool TRACE = false>
+        void _run_threaded();
+        void _count_op() {this->_stats.instructions++; this->_stats.peak_stack = std::max(this->_stats.peak_stack, this->_stack.size());}
+        void _trace_op(const Instruction& inst) {this->_trace->record(this->_next_op, inst.op_code, this->_stack.size(), this->_stack.empty() ? nullptr : &this->_stack.back());}
+        void _run_jit();
+        void _run_registers();
+        void _run_register_code(const RegisterProgram& program, Value* regs);
+        // runs any single instruction, used by the JIT's helpers
+        template <InstructionType OP, bool CHECKED>
+        void _run_op(Instruction& inst);
+        template <InstructionType OP, bool CHECKED>
+        static int _jit_helper(void* context, Instruction* inst);
+        template <bool CHECKED, size_t... OPS>
+        static std::array<JitHelper, sizeof...(OPS)> _jit_helpers(std::index_sequence<OPS...>);
+        // grouped handlers, used by the loop engine
         void _stack_op(const Instruction& inst);
         void _arith_op(const Instruction& inst);
-        Value _float_op(const Instruction& inst, float rhs, float lhs);
         void _logic_op(const Instruction& inst);
         void _comp_op(const Instruction& inst);
-        void _not_op(const Instruction& inst);
         void _jump_op(const Instruction& inst);
         void _var_op(const Instruction& inst);
         void _io_op(const Instruction& inst);
         void _arr_op(const Instruction& inst);
         void _type_op(const Instruction& inst);
+        template <bool CHECKED = true>
         void _cond_op();
+        // single op code handlers, handlers with CHECKED set to false skip the checks the verifier has proven redundant
+        void _push_op(const Instruction& inst);
+        template <bool CHECKED = true>
+        void _pop_op();
+        template <bool CHECKED = true>
+        void _swap_op();
+        void _peek_op();
+        template <InstructionType OP, bool CHECKED = true>
+        void _arith_values(Value& left_val, const Value& right_val);
+        template <InstructionType OP, bool CHECKED = true>
+        void _arith();
+        template <InstructionType OP, bool CHECKED = true>
+        void _logic();
+        template <InstructionType OP, bool CHECKED = true>
+        bool _compare_values(const Value& left_val, const Value& right_val);
+        template <InstructionType OP, bool CHECKED = true>
+        void _compare();
+        template <bool CHECKED = true>
+        void _not_op(const Instruction& inst);
+        template <bool CHECKED = true>
+        void _jumpif_op(const Instruction& inst);
+        void _get_op(const Instruction& inst);
+        template <bool CHECKED = true>
+        void _set_op(const Instruction& inst);
+        template <bool CHECKED = true>
+        void _print_op(bool newline);
+        void _print_value(const Value& val, bool newline);
+        std::string _read_line();
+        void _read_op();
+        void _readint_op();
+        Value _read_int();
+        template <bool CHECKED = true>
+        void _at_op();
+        template <bool CHECKED = true>
+        void _len_op();
+        void _valtype_op();
+        void _convert_op();
+        // superinstruction handlers
+        template <InstructionType OP, bool CHECKED = true>
+        void _compare_jump(const Instruction& inst);
+        void _compare_jump_op(const Instruction& inst);
+        template <bool CHECKED = true>
+        void _add_imm_op(const Instruction& inst);
+        template <bool CHECKED = true>
+        void _inc_var_op(const Instruction& inst);
+        // quickened instruction handlers, these return false without running if the operands don't match their types
+        void _quicken(Instruction& inst);
+        void _despecialize(Instruction& inst);
+        template <InstructionType OP, ValueType TYPE>
+        bool _arith_typed();
+        template <InstructionType OP, ValueType TYPE>
+        bool _compare_typed();
+        template <InstructionType OP>
+        bool _compare_jump_int(const Instruction& inst);
+        // register instruction handlers
+        template <InstructionType OP>
+        void _reg_binary(Value* regs, const RegInstruction& inst);
+        template <InstructionType OP>
+        bool _reg_compare(const Value& left_val, const Value& right_val);
     public:
+        Interpreter(size_t max_stack = DEFAULT_MAX_STACK);
         Value stack_pop();
         void stack_push(const Value& val);
+        void stack_push(Value&& val);
         void stack_dup();
         size_t stack_size() {return this->_stack.size();}
         bool stack_empty() {return this->_stack.empty();}
         const Value& stack_top();
+        void set_engine(ExecEngine engine) {this->_engine = engine;}
+        void set_max_stack(size_t max_stack);
+        void set_optimize(bool optimize) {this->_parser.set_optimize(optimize);}
+        void set_verify(bool verify) {this->_verify = verify;}
+        void set_flush_policy(FlushPolicy policy) {this->_output.set_policy(policy);}
+        void set_float_format(FloatFormat format) {this->_output.set_float_format(format);}
+        // returns the address of the instruction being run, or NOT_RUNNING if none is, this is safe to call from a signal handler
+        size_t current_op() const;
+        const std::vector<LineEntry>& lines() const {return this->_parser.lines();}
+        // counts every instruction run and the peak stack depth, running them all on the threaded engine whichever engine is selected
+        void set_stats(bool collect) {this->_collect_stats = collect;}
+        InterpreterStats stats() const;
+        void write_stats(std::ostream& out) const;
+        // profiles every instruction run, running them all on the loop engine whichever engine is selected
+        void set_profile(bool profile) {this->_profile = profile;}
+        void print_profile(std::ostream& out) const {this->_profiler.report(out, this->_instructions, this->_labels);}
+        void write_profile(std::ostream& out) const {this->_profiler.write_json(out, this->_instructions, this->_labels);}
+        // traces every instruction run, running them all on the threaded engine whichever engine is selected, or stops tracing if the trace is null
+        void set_trace(TraceWriter* trace) {this->_trace = trace;}
         Value run_expr(std::string expr);
-        Value run_prog(std::stringstream& program);
+        // the labels that expressions waiting to run are jumping to
+        std::vector<std::string> pending_labels() const {return this->_parser.pending_labels(this->_instructions);}
+        void discard_pending();
+        Value run_prog(std::string_view source);
+        CompiledProgram compile_prog(std::string_view source);
+        Value run_compiled(CompiledProgram program);
         void reset_state();
 };
 
-#endif
\ No newline at end of file
+#endif
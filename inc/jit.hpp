@@ -0,0 +1,60 @@
+#ifndef JIT_H
+#define JIT_H
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "../inc/value.hpp"
+#include "../inc/value_stack.hpp"
+#include "../inc/instruction.hpp"
+
+/*
+    a template JIT for hot loops. a loop's instructions are compiled by stitching together a short machine code
+    template for each instruction. stack, variable, int arithmetic and branch templates work on the stack and
+    variables directly, with guards on their operands' types that fall back to calling a helper, which runs the
+    instruction with the interpreter's handlers. every other instruction just calls its helper, and instructions the
+    JIT doesn't support return control to the interpreter. native code is only generated on x86-64 Linux, elsewhere
+    every loop stays in the interpreter
+*/
+
+// the number of times a backward jump must be taken before the loop it closes is compiled
+const unsigned JIT_THRESHOLD {50};
+
+// runs a single instruction, returns 1 if it took a branch, 0 if it didn't, or -1 if it raised an error
+typedef int (*JitHelper)(void* context, Instruction* inst);
+
+// how the native code handles an instruction
+enum class JitAction{
+    JIT_HELPER,     // calls the instruction's helper, and continues to the next instruction
+    JIT_BRANCH,     // calls the instruction's helper, and jumps to the instruction's target if it took the branch
+    JIT_JUMP,       // jumps to the instruction's target
+    JIT_EXIT        // returns to the interpreter to run the instruction
+};
+
+struct JitOp{
+    JitAction action;
+    JitHelper helper;
+};
+
+// returns how the JIT handles an op code
+JitAction jit_action(InstructionType op_code);
+// returns true if native code can be generated on this platform
+bool jit_supported();
+
+// native code for a range of instructions, which can be entered at any instruction that isn't run by the interpreter
+class JitRegion{
+    private:
+        uint8_t* _code {nullptr};
+        size_t _code_size {0};
+        size_t _start {0};
+        std::vector<uint32_t> _offsets;
+        JitRegion() {}
+    public:
+        JitRegion(const JitRegion&) = delete;
+        JitRegion& operator=(const JitRegion&) = delete;
+        ~JitRegion();
+        static std::unique_ptr<JitRegion> compile(std::vector<Instruction>& instructions, size_t start, size_t end, const std::vector<JitOp>& ops, Value* vars);
+        long run(void* context, ValueStack& stack, size_t index);
+};
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include <array>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include "../inc/token.hpp"
+#include "../inc/value.hpp"
+#include "../inc/instruction.hpp"
+
+/*
+    every keyword of the language, with everything the lexer and parser need to know about it. keywords are found
+    with a perfect hash built at compile time, so looking up a word hashes it once and compares it with at most one
+    keyword, and tokens carry their keyword so the parser never looks their text up again
+*/
+struct Keyword{
+    std::string_view spelling;
+    TokenType type;
+    InstructionType op_code {InstructionType::INST_NULL};
+    InstructionType condition {InstructionType::INST_NULL};     // the comparison made by a compound conditional jump
+    ValueType value_type {ValueType::TYPE_NULL};                // the type named by a type keyword
+};
+
+inline constexpr Keyword keywords[] = {
+    {"push", TokenType::INST_T, InstructionType::INST_PUSH},
+    {"->", TokenType::INST_T, InstructionType::INST_PUSH},
+    {"pop", TokenType::INST_T, InstructionType::INST_POP},
+    {"clear", TokenType::INST_T, InstructionType::INST_CLEAR},
+    {"peek", TokenType::INST_T, InstructionType::INST_PEEK},
+    {"swap", TokenType::INST_T, InstructionType::INST_SWAP},
+    {"dup", TokenType::INST_T, InstructionType::INST_DUP},
+    {"size", TokenType::INST_T, InstructionType::INST_SIZE},
+    {"add", TokenType::INST_T, InstructionType::INST_ADD},
+    {"+", TokenType::INST_T, InstructionType::INST_ADD},
+    {"sub", TokenType::INST_T, InstructionType::INST_SUB},
+    {"-", TokenType::INST_T, InstructionType::INST_SUB},
+    {"mul", TokenType::INST_T, InstructionType::INST_MUL},
+    {"*", TokenType::INST_T, InstructionType::INST_MUL},
+    {"div", TokenType::INST_T, InstructionType::INST_DIV},
+    {"/", TokenType::INST_T, InstructionType::INST_DIV},
+    {"mod", TokenType::INST_T, InstructionType::INST_MOD},
+    {"%", TokenType::INST_T, InstructionType::INST_MOD},
+    {"and", TokenType::INST_T, InstructionType::INST_AND},
+    {"&", TokenType::INST_T, InstructionType::INST_AND},
+    {"or", TokenType::INST_T, InstructionType::INST_OR},
+    {"|", TokenType::INST_T, InstructionType::INST_OR},
+    {"xor", TokenType::INST_T, InstructionType::INST_XOR},
+    {"^", TokenType::INST_T, InstructionType::INST_XOR},
+    {"not", TokenType::INST_T, InstructionType::INST_NOT},
+    {"!", TokenType::INST_T, InstructionType::INST_NOT},
+    {"eq", TokenType::INST_T, InstructionType::INST_EQ},
+    {"==", TokenType::INST_T, InstructionType::INST_EQ},
+    {"neq", TokenType::INST_T, InstructionType::INST_NEQ},
+    {"!=", TokenType::INST_T, InstructionType::INST_NEQ},
+    {"gt", TokenType::INST_T, InstructionType::INST_GREATER},
+    {">", TokenType::INST_T, InstructionType::INST_GREATER},
+    {"lt", TokenType::INST_T, InstructionType::INST_LESS},
+    {"<", TokenType::INST_T, InstructionType::INST_LESS},
+    {"gte", TokenType::INST_T, InstructionType::INST_GREATER_EQ},
+    {">=", TokenType::INST_T, InstructionType::INST_GREATER_EQ},
+    {"lte", TokenType::INST_T, InstructionType::INST_LESS_EQ},
+    {"<=", TokenType::INST_T, InstructionType::INST_LESS_EQ},
+    {"j", TokenType::INST_T, InstructionType::INST_JUMP},
+    {"jif", TokenType::INST_T, InstructionType::INST_JUMPIF},
+    {"j==", TokenType::INST_T, InstructionType::INST_JUMPIF, InstructionType::INST_EQ},
+    {"j!=", TokenType::INST_T, InstructionType::INST_JUMPIF, InstructionType::INST_NEQ},
+    {"j<", TokenType::INST_T, InstructionType::INST_JUMPIF, InstructionType::INST_LESS},
+    {"j>", TokenType::INST_T, InstructionType::INST_JUMPIF, InstructionType::INST_GREATER},
+    {"j<=", TokenType::INST_T, InstructionType::INST_JUMPIF, InstructionType::INST_LESS_EQ},
+    {"j>=", TokenType::INST_T, InstructionType::INST_JUMPIF, InstructionType::INST_GREATER_EQ},
+    {"call", TokenType::INST_T, InstructionType::INST_CALL},
+    {"ret", TokenType::INST_T, InstructionType::INST_RET},
+    {"set", TokenType::INST_T, InstructionType::INST_SET},
+    {"<-", TokenType::INST_T, InstructionType::INST_SET},
+    {"get", TokenType::INST_T, InstructionType::INST_GET},
+    {"print", TokenType::INST_T, InstructionType::INST_PRINT},
+    {"println", TokenType::INST_T, InstructionType::INST_PRINTLN},
+    {"print_p", TokenType::INST_T, InstructionType::INST_PRINT},
+    {"println_p", TokenType::INST_T, InstructionType::INST_PRINTLN},
+    {"read", TokenType::INST_T, InstructionType::INST_READ},
+    {"readint", TokenType::INST_T, InstructionType::INST_READINT},
+    {"flush", TokenType::INST_T, InstructionType::INST_FLUSH},
+    {"at", TokenType::INST_T, InstructionType::INST_AT},
+    {"len", TokenType::INST_T, InstructionType::INST_LEN},
+    {"conv", TokenType::INST_T, InstructionType::INST_CONVERT},
+    {"type", TokenType::INST_T, InstructionType::INST_TYPE},
+    {"?", TokenType::INST_T, InstructionType::INST_COND},
+    {"TRUE", TokenType::BOOL_T},
+    {"FALSE", TokenType::BOOL_T},
+    {"int", TokenType::TYPE_T, InstructionType::INST_NULL, InstructionType::INST_NULL, ValueType::TYPE_INT},
+    {"float", TokenType::TYPE_T, InstructionType::INST_NULL, InstructionType::INST_NULL, ValueType::TYPE_FLOAT},
+    {"bool", TokenType::TYPE_T, InstructionType::INST_NULL, InstructionType::INST_NULL, ValueType::TYPE_BOOL},
+    {"char", TokenType::TYPE_T, InstructionType::INST_NULL, InstructionType::INST_NULL, ValueType::TYPE_CHAR},
+    {"string", TokenType::TYPE_T, InstructionType::INST_NULL, InstructionType::INST_NULL, ValueType::TYPE_STR}
+};
+
+inline constexpr size_t KEYWORD_COUNT {std::size(keywords)};
+inline constexpr size_t KEYWORD_SLOTS {512};
+
+// a seeded FNV-1a hash, mixed so that its low bits depend on every character
+constexpr uint32_t keyword_hash(std::string_view word, uint32_t seed){
+    uint32_t hash = 2166136261u ^ seed;
+    for (char chr : word){
+        hash ^= static_cast<uint8_t>(chr);
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 15);
+}
+
+// the first seed that gives every keyword its own slot
+consteval uint32_t keyword_seed(){
+    for (uint32_t seed = 0; seed < 10000; seed++){
+        std::array<bool, KEYWORD_SLOTS> used {};
+        bool perfect {true};
+        for (const Keyword& keyword : keywords){
+            size_t slot = keyword_hash(keyword.spelling, seed) % KEYWORD_SLOTS;
+            if (used[slot]){
+                perfect = false;
+                break;
+            }
+            used[slot] = true;
+        }
+        if (perfect)
+            return seed;
+    }
+    throw "no perfect hash seed for the keyword table";
+}
+
+inline constexpr uint32_t KEYWORD_SEED {keyword_seed()};
+
+// maps each slot to the index of the keyword hashed to it, or KEYWORD_COUNT if no keyword hashes to it
+consteval std::array<uint8_t, KEYWORD_SLOTS> keyword_slots(){
+    static_assert(KEYWORD_COUNT < 256);
+    std::array<uint8_t, KEYWORD_SLOTS> slots {};
+    slots.fill(KEYWORD_COUNT);
+    for (size_t i = 0; i < KEYWORD_COUNT; i++)
+        slots[keyword_hash(keywords[i].spelling, KEYWORD_SEED) % KEYWORD_SLOTS] = i;
+    return slots;
+}
+
+inline constexpr std::array<uint8_t, KEYWORD_SLOTS> KEYWORD_TABLE {keyword_slots()};
+
+// returns the keyword spelled by a word, or nullptr if the word isn't a keyword
+constexpr const Keyword* find_keyword(std::string_view word){
+    uint8_t index = KEYWORD_TABLE[keyword_hash(word, KEYWORD_SEED) % KEYWORD_SLOTS];
+    if (index == KEYWORD_COUNT || keywords[index].spelling != word)
+        return nullptr;
+    return &keywords[index];
+}
+
+#endif
@@ -1,13 +1,15 @@
 #ifndef LEXER_H
 #define LEXER_H 
 
-#include <string>
-#include <sstream>
+#include <string_view>
 #include <vector>
 
 #include "../inc/token.hpp"
 
-std::vector<Token> tokenize_expr(std::string& expr);
-std::vector<std::vector<Token>> tokenize_program(std::stringstream& ss);
+// sources are only lexed in parallel when each thread gets at least this many bytes
+const size_t PARALLEL_LEX_CHUNK_SIZE {1 << 20};
+
+std::vector<Token> tokenize_expr(std::string_view expr);
+TokenizedProgram tokenize_program(std::string_view source);
 
 #endif
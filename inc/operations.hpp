@@ -0,0 +1,123 @@
+#ifndef OPERATIONS_H
+#define OPERATIONS_H
+
+#include <stdexcept>
+#include "../inc/value.hpp"
+#include "../inc/instruction.hpp"
+
+/*
+    the value level semantics of Evo's operators, shared by the interpreter and the parser's constant folding.
+    errors are raised as std::runtime_error without a line number, the interpreter adds it before reporting them.
+    setting CHECKED to false skips the operand type checks, this may only be done where the verifier has proven
+    the operand types are valid
+*/
+
+// applies an arithmetic operation to two values, storing the result in the left value
+template <InstructionType OP, bool CHECKED = true>
+void arith_values(Value& left_val, const Value& right_val){
+    // ensure values match and are of the right type
+    if constexpr (CHECKED){
+        if (right_val.get_type() != left_val.get_type())
+            throw std::runtime_error("arithmetic cannot be performed on mismatch types");
+        if (!type_traits(right_val.get_type()).numeric)
+            throw std::runtime_error("invalid type for arithmetic operation");
+    }
+    // check if the values are float values
+    if (right_val.get_type() == ValueType::TYPE_FLOAT){
+        float rhs {right_val.get_float()}, lhs {left_val.get_float()};
+        if constexpr (OP == InstructionType::INST_ADD)
+            left_val = Value(ValueType::TYPE_FLOAT, lhs + rhs);
+        else if constexpr (OP == InstructionType::INST_SUB)
+            left_val = Value(ValueType::TYPE_FLOAT, lhs - rhs);
+        else if constexpr (OP == InstructionType::INST_MUL)
+            left_val = Value(ValueType::TYPE_FLOAT, lhs * rhs);
+        else if constexpr (OP == InstructionType::INST_DIV)
+            left_val = Value(ValueType::TYPE_FLOAT, lhs / rhs);
+        else
+            throw std::runtime_error("invalid type for arithmetic operation");
+        return;
+    }
+    int rhs {right_val.get_int()}, lhs {left_val.get_int()}, retval;
+    if constexpr (OP == InstructionType::INST_DIV || OP == InstructionType::INST_MOD){
+        if (rhs == 0)
+            throw std::runtime_error("division by zero");
+    }
+    if constexpr (OP == InstructionType::INST_ADD)
+        retval = lhs + rhs;
+    else if constexpr (OP == InstructionType::INST_SUB)
+        retval = lhs - rhs;
+    else if constexpr (OP == InstructionType::INST_MUL)
+        retval = lhs * rhs;
+    else if constexpr (OP == InstructionType::INST_DIV)
+        retval = lhs / rhs;
+    else
+        retval = lhs % rhs;
+    left_val = Value(ValueType::TYPE_INT, retval);
+}
+
+// applies a logical operation to two values, storing the result in the left value
+template <InstructionType OP, bool CHECKED = true>
+void logic_values(Value& left_val, const Value& right_val){
+    // ensure values match and are of an integral type
+    if constexpr (CHECKED){
+        if (right_val.get_type() != left_val.get_type())
+            throw std::runtime_error("logical operations cannot be performed on mismatch types");
+        if (!right_val.is_intergral())
+            throw std::runtime_error("invalid type for logical operation");
+    }
+    int lhs {left_val.get_int()}, rhs {right_val.get_int()}, retval;
+    if constexpr (OP == InstructionType::INST_AND)
+        retval = lhs & rhs;
+    else if constexpr (OP == InstructionType::INST_OR)
+        retval = lhs | rhs;
+    else
+        retval = lhs ^ rhs;
+    left_val = Value::from_int(left_val.get_type(), retval);
+}
+
+// compares two values, and returns the result
+template <InstructionType OP, bool CHECKED = true>
+bool compare_values(const Value& left_val, const Value& right_val){
+    if constexpr (OP == InstructionType::INST_EQ || OP == InstructionType::INST_NEQ){
+        // this is some black magic
+        return (left_val == right_val) == static_cast<bool>(static_cast<int>(OP) - 17);
+    }
+    else{
+        int comparison_offset {19};
+        if constexpr (CHECKED){
+            if (!left_val.is_intergral() || !right_val.is_intergral())
+                throw std::runtime_error("comparison operations cannot be performed on non-integral types");
+        }
+        // check if this is a "or equal operation"
+        if constexpr (OP > InstructionType::INST_GREATER){
+            if (left_val == right_val)
+                return true;
+            comparison_offset += 2;
+        }
+        // similar black magic to above, integral values all share the int field so it can be compared directly
+        return (left_val.get_int() > right_val.get_int()) == static_cast<bool>(static_cast<int>(OP) - comparison_offset);
+    }
+}
+
+/*
+    compares two integral values of the same type, giving the same results as compare_values. note that "lt" has always
+    been an inclusive comparison, which is kept here
+*/
+template <InstructionType OP>
+bool compare_ints(int lhs, int rhs){
+    if constexpr (OP == InstructionType::INST_NEQ)
+        return lhs != rhs;
+    else if constexpr (OP == InstructionType::INST_EQ)
+        return lhs == rhs;
+    else if constexpr (OP == InstructionType::INST_LESS || OP == InstructionType::INST_LESS_EQ)
+        return lhs <= rhs;
+    else if constexpr (OP == InstructionType::INST_GREATER)
+        return lhs > rhs;
+    else
+        return lhs >= rhs;
+}
+
+bool not_value(const Value& val);
+Value convert_value(const Value& val, ValueType type);
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <vector>
+#include <string_view>
+#include <ostream>
+#include <iostream>
+#include <cstring>
+#include "../inc/value.hpp"
+
+/*
+    a program's output is collected in a buffer owned by its interpreter, and written to the output stream in large
+    blocks rather than through the stream for every value printed. values are formatted in place in the buffer, so
+    printing one never builds a string first. when the buffer is written depends on its flush policy, but it's always
+    written before reading input, so prompts are shown before the program waits on them, and once the program stops
+*/
+
+enum class FlushPolicy{
+    FLUSH_BLOCK,        // written whenever the buffer fills
+    FLUSH_LINE,         // written at the end of every line
+    FLUSH_EXPLICIT      // only written by the flush instruction, before reading input, and once the program stops
+};
+
+// the bytes collected before the buffer is written, unless it's only flushed explicitly, in which case it grows as needed
+const size_t OUTPUT_BLOCK_SIZE {1 << 16};
+
+// returns the line policy if stdout is a terminal, and the block policy otherwise
+FlushPolicy default_flush_policy();
+
+class OutputBuffer{
+    private:
+        std::ostream* _out;
+        std::vector<char> _buffer;
+        size_t _used {0};
+        FlushPolicy _policy;
+        FloatFormat _float_format {FloatFormat::FLOAT_FIXED};
+        void _make_room(size_t size);
+        // returns where the next size bytes can be written, writing out or growing the buffer if they don't fit
+        char* _reserve(size_t size);
+    public:
+        OutputBuffer(std::ostream& out = std::cout, FlushPolicy policy = FlushPolicy::FLUSH_BLOCK);
+        OutputBuffer(const OutputBuffer&) = delete;
+        OutputBuffer& operator=(const OutputBuffer&) = delete;
+        ~OutputBuffer() {this->flush();}
+        void set_policy(FlushPolicy policy) {this->_policy = policy;}
+        void set_float_format(FloatFormat format) {this->_float_format = format;}
+        void write(std::string_view str);
+        // writes the text of a value, formatting it in place in the buffer
+        void write_value(const Value& val);
+        void new_line();
+        // writes everything in the buffer to the output stream
+        void flush();
+};
+
+inline char* OutputBuffer::_reserve(size_t size){
+    if (this->_used + size > this->_buffer.size())
+        this->_make_room(size);
+    return this->_buffer.data() + this->_used;
+}
+
+inline void OutputBuffer::write(std::string_view str){
+    std::memcpy(this->_reserve(str.size()), str.data(), str.size());
+    this->_used += str.size();
+}
+
+inline void OutputBuffer::write_value(const Value& val){
+    ValueType type = val.get_type();
+    if (type == ValueType::TYPE_STR || type == ValueType::TYPE_NAME){
+        this->write(val.get_str());
+        return;
+    }
+    char* end = val.format_scalar(this->_reserve(MAX_SCALAR_CHARS), this->_float_format);
+    this->_used = end - this->_buffer.data();
+}
+
+inline void OutputBuffer::new_line(){
+    *this->_reserve(1) = '\n';
+    this->_used++;
+    if (this->_policy == FlushPolicy::FLUSH_LINE)
+        this->flush();
+}
+
+#endif
@@ -2,36 +2,74 @@
 #define PARSER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <span>
+#include <functional>
 #include <unordered_map>
 
 #include "../inc/token.hpp"
 #include "../inc/instruction.hpp"
 
+// hashes strings and string views alike, so symbols can be looked up by a token's text without copying it
+struct SymbolHash{
+    using is_transparent = void;
+    size_t operator()(std::string_view name) const {return std::hash<std::string_view>{}(name);}
+};
+
+typedef std::unordered_map<std::string, int, SymbolHash, std::equal_to<>> SymbolTable;
+
+// how much the parser had parsed and declared at some point, so everything after it can be undone
+struct ParserMark{
+    size_t instructions;
+    size_t vars;
+    size_t labels;
+};
 
+// the parser reads its tokens in place, so they must outlive each call to parse them
 class Parser{
     private:
-        std::vector<Token> _tokens;
+        std::span<const Token> _tokens;
         std::vector<Instruction> _instructions;
         std::vector<std::string> _word_stack;
-        std::vector<std::string> _vars;
-        std::unordered_map<std::string, int> _labels;
-        std::vector<size_t> _jump_indexes;
-        size_t _inst_no {0};
+        SymbolTable _var_slots;
+        std::vector<std::string> _var_names;
+        SymbolTable _labels;
+        std::vector<std::string> _label_order;  // the labels in the order they were declared
+        std::vector<size_t> _jump_indexes;      // the jumps whose labels weren't declared yet when they were parsed
+        std::vector<LineEntry> _lines;
+        size_t _fold_barrier {0};
         size_t _line_no {0};
+        bool _optimize {false};
         void _parse_literal(const Token& token);
         void _parse_word(const Token& token);
         void _parse_inst(const Token& token);
         void _parse_label(const Token& token);
         void _parse_type(const Token& token);
+        void _parse_tokens();
+        void _mark_line();
+        bool _resolve_labels(bool require_all);
+        void _emit_op(InstructionType op_code);
+        bool _fold(InstructionType op_code);
+        int _var_slot(std::string_view name);
+        int _declare_var(std::string_view name);
+        size_t _fuse(size_t index, const std::vector<bool>& is_target, std::vector<Instruction>& out);
+        std::vector<bool> _jump_targets() const;
+        void _peephole();
     public:
         Parser() {}
-        Parser(const std::vector<Token>& tokens) : _tokens(tokens) {}
-        void set_tokens(const std::vector<Token>& tokens);
+        void set_optimize(bool optimize) {this->_optimize = optimize;}
+        const std::vector<std::string>& var_names() const {return this->_var_names;}
+        std::vector<ProgramLabel> labels() const;
+        const std::vector<LineEntry>& lines() const {return this->_lines;}
+        void set_lines(std::vector<LineEntry> lines) {this->_lines = std::move(lines);}
+        void declare_vars(const std::vector<std::string>& names);
         void reset();
-        void reset(const std::vector<Token>& tokens);
-        std::vector<Instruction> parse_expr(bool clear = false);
-        std::vector<Instruction> parse_program(std::vector<std::vector<Token>>& tokens);
+        bool parse_append(std::span<const Token> tokens, std::vector<Instruction>& code);
+        ParserMark mark(const std::vector<Instruction>& code) const;
+        void rollback(const ParserMark& mark, std::vector<Instruction>& code);
+        std::vector<std::string> pending_labels(const std::vector<Instruction>& code) const;
+        std::vector<Instruction> parse_program(const TokenizedProgram& program);
 };
 
 #endif
\ No newline at end of file
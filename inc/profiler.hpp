@@ -0,0 +1,53 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <vector>
+#include <ostream>
+#include <chrono>
+#include <cstdint>
+#include "../inc/instruction.hpp"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    #include <x86intrin.h>
+    #define EVO_PROFILE_TSC
+#endif
+
+/*
+    the profiler records how many times each instruction runs and how long it takes, and how many times each jump is
+    taken backwards, which is how loops are found. everything is recorded per instruction, and only grouped by op
+    code and by label when a report is made, so recording an instruction is just two additions. time is measured in
+    cycles of the time stamp counter where there is one, and in nanoseconds elsewhere
+*/
+
+#ifdef EVO_PROFILE_TSC
+    inline constexpr const char* PROFILE_CLOCK_UNIT {"cycles"};
+#else
+    inline constexpr const char* PROFILE_CLOCK_UNIT {"ns"};
+#endif
+
+// reads the profiler's clock
+inline uint64_t profile_clock(){
+#ifdef EVO_PROFILE_TSC
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+class Profiler{
+    private:
+        std::vector<uint64_t> _counts;
+        std::vector<uint64_t> _cycles;
+        std::vector<uint64_t> _back_jumps;
+    public:
+        // makes room for a program of the given size, keeping what has already been recorded
+        void resize(size_t inst_count);
+        void clear();
+        void record(size_t index, uint64_t cycles) {this->_counts[index]++; this->_cycles[index] += cycles;}
+        void record_back_jump(size_t index) {this->_back_jumps[index]++;}
+        // prints a report of the hottest op codes, labels and loops, the labels must be sorted by address
+        void report(std::ostream& out, const std::vector<Instruction>& instructions, const std::vector<ProgramLabel>& labels) const;
+        void write_json(std::ostream& out, const std::vector<Instruction>& instructions, const std::vector<ProgramLabel>& labels) const;
+};
+
+#endif
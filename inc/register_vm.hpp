@@ -0,0 +1,93 @@
+#ifndef REGISTER_VM_H
+#define REGISTER_VM_H
+
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include "../inc/value.hpp"
+#include "../inc/instruction.hpp"
+
+/*
+    a register based form of a program, translated from the parser's stack bytecode. every variable, every literal
+    and every stack slot gets its own register, so an instruction reads its operands from wherever they already are
+    and writes its result straight to its destination. for example "set acc add acc ctr" is four stack instructions,
+    but a single register instruction. this only works where the depth of the stack before each instruction is
+    known, so programs whose stack depth depends on the path taken to an instruction can't be translated
+*/
+
+enum class RegOp : uint8_t{
+    REG_MOVE,           // dest = a
+    REG_GET,            // dest = a, raising an error if the variable a hasn't been declared
+    REG_SWAP,           // swaps a and b
+    REG_PEEK,           // dest = the stack slot (b - 1) - index below slot b, the index is read from a
+    REG_ADD,            // dest = a + b, and so on for each binary operation, in the same order as their op codes
+    REG_SUB,
+    REG_MUL,
+    REG_DIV,
+    REG_MOD,
+    REG_AND,
+    REG_OR,
+    REG_XOR,
+    REG_NOT,            // dest = not a
+    REG_NEQ,
+    REG_EQ,
+    REG_LESS,
+    REG_GREATER,
+    REG_LESS_EQ,
+    REG_GREATER_EQ,
+    REG_INC_VAR,        // dest += b, raising an error if the variable dest hasn't been declared
+    REG_JUMP,           // jumps to target
+    REG_JUMPIF,         // jumps to target if a is true
+    REG_JUMP_NEQ,       // jumps to target if a != b, and so on for each comparison
+    REG_JUMP_EQ,
+    REG_JUMP_LESS,
+    REG_JUMP_GREATER,
+    REG_JUMP_LESS_EQ,
+    REG_JUMP_GREATER_EQ,
+    REG_CALL,           // pushes the index of the stack instruction it was translated from as the return address, and jumps to target
+    REG_RET,            // returns to the instruction after the last call
+    REG_PRINT,          // prints a, followed by a new line if b is set
+    REG_READ,           // dest = a line of input
+    REG_READINT,        // dest = a line of input, as an int
+    REG_FLUSH,          // writes the output buffer
+    REG_AT,             // dest = the character of the collection b at the index a
+    REG_LEN,            // dest = the length of a
+    REG_TYPE,           // dest = the type of a
+    REG_CONVERT,        // dest = a converted to the type b
+    REG_COND,           // dest = b if a is true, otherwise c
+    REG_HALT            // ends the program
+};
+
+struct RegInstruction{
+    RegOp op;
+    uint32_t dest {0};
+    uint32_t a {0};
+    uint32_t b {0};
+    uint32_t c {0};
+    uint32_t target {0};    // the index of the register instruction a jump goes to
+    RegInstruction(RegOp op, uint32_t dest = 0, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0) : op(op), dest(dest), a(a), b(b), c(c) {}
+};
+
+/*
+    registers are laid out as the variables, in slot order, followed by the stack slots, from the bottom of the stack,
+    followed by the literals. the values of the stack slots below the entry depth are copied in before running, and
+    the slots below the exit depth are copied back out when the program halts
+*/
+struct RegisterProgram{
+    std::vector<RegInstruction> code;
+    std::vector<Value> constants;
+    size_t stack_base {0};
+    size_t const_base {0};
+    size_t exit_depth {0};
+    std::vector<uint32_t> entry_points;    // the register instruction each stack instruction starts at, used for returns
+};
+
+/*
+    translates a program that starts running with entry_depth values on the stack, and with the given variable
+    values. returns nullopt if the program can't be translated, because the stack depth at some instruction isn't
+    fixed, or because an instruction is certain to fail its stack check or overflow a stack of max_stack values,
+    those errors are left to the stack engines to report
+*/
+std::optional<RegisterProgram> translate_to_registers(const std::vector<Instruction>& instructions, size_t entry_depth, const std::vector<Value>& vars, size_t max_stack);
+
+#endif
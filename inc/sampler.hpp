@@ -0,0 +1,37 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <vector>
+#include <ostream>
+#include <string_view>
+#include <cstdint>
+#include "../inc/instruction.hpp"
+#include "../inc/interpreter.hpp"
+
+/*
+    a sampling profiler, which interrupts the program on a timer of the CPU time it uses, and records the instruction
+    the interpreter is running. nothing is added to the instructions themselves, so the program runs at full speed
+    between samples, and the samples are grouped into source lines with the program's line table. samples are taken
+    with SIGPROF, so sampling is only supported on POSIX systems, and only one sampler can run at a time
+*/
+
+// the CPU time between samples, in microseconds
+const long SAMPLE_INTERVAL_US {1000};
+
+class Sampler{
+    private:
+        std::vector<uint64_t> _samples;     // the samples taken at each instruction, followed by those taken outside the program
+        bool _running {false};
+    public:
+        Sampler() {}
+        Sampler(const Sampler&) = delete;
+        Sampler& operator=(const Sampler&) = delete;
+        ~Sampler();
+        // starts sampling an interpreter running a program of the given size, throws an error if sampling isn't supported
+        void start(const Interpreter& machine, size_t inst_count);
+        void stop();
+        // prints the hottest source lines, showing their text if the source is given
+        void report(std::ostream& out, const std::vector<LineEntry>& lines, std::string_view source = {}) const;
+};
+
+#endif
@@ -0,0 +1,26 @@
+#ifndef SOURCE_FILE_H
+#define SOURCE_FILE_H
+
+#include <string>
+#include <string_view>
+
+/*
+    the source of a program. regular files are mapped into memory read only, so the lexer reads the file's bytes
+    directly without copying them. pipes, stdin, and platforms without mmap fall back to reading the whole source
+    into a buffer with a single read loop
+*/
+class SourceFile{
+    private:
+        const char* _mapped {nullptr};
+        size_t _size {0};
+        std::string _buffer;
+    public:
+        // opens the file at the given path, or reads stdin if the path is "-"
+        SourceFile(const std::string& path);
+        SourceFile(const SourceFile&) = delete;
+        SourceFile& operator=(const SourceFile&) = delete;
+        ~SourceFile();
+        std::string_view text() const;
+};
+
+#endif
@@ -1,7 +1,8 @@
 #ifndef TOKEN_H
 #define TOKEN_H
 
-#include <string>
+#include <string_view>
+#include <vector>
 
 enum class TokenType{
     INT_T,
@@ -16,10 +17,20 @@ enum class TokenType{
     NULL_T
 };
 
+struct Keyword;
+
+// a token's text is a slice of the source it was read from, so the source must outlive it
 struct Token{
     TokenType type;
-    std::string text;
-    Token(TokenType type, const std::string text) {this->type = type; this->text = text;}
+    std::string_view text;
+    const Keyword* keyword {nullptr};   // the keyword the token spells, if any
+    Token(TokenType type, std::string_view text, const Keyword* keyword = nullptr) {this->type = type; this->text = text; this->keyword = keyword;}
+};
+
+// the tokens of a program, each line of the source is a single expression
+struct TokenizedProgram{
+    std::vector<Token> tokens;
+    std::vector<size_t> line_ends;  // the index one past the last token of each line
 };
 
 #endif
\ No newline at end of file
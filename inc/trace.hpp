@@ -0,0 +1,82 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <fstream>
+#include <cstdint>
+#include <cstring>
+#include "../inc/value.hpp"
+#include "../inc/instruction.hpp"
+
+/*
+    an execution trace records every instruction a program runs, in the order they ran, so a run can be replayed and
+    studied after it's over. a trace file is a header, followed by the program's labels, then the bytes of their names,
+    then one fixed-size record per instruction run. records are collected in a block in memory and written out a block
+    at a time, so recording an instruction is just filling in a record, and the file is only touched once per block.
+    numbers are stored in the byte order of the machine that wrote the file, and the version is bumped whenever the
+    layout or the op codes change
+*/
+
+const uint32_t EVOT_VERSION {2};
+// the records written to the file at a time
+const size_t TRACE_BLOCK_RECORDS {1 << 16};
+
+// an instruction that ran, and a summary of the stack before it ran
+struct TraceRecord{
+    uint32_t address;
+    uint32_t depth;     // the number of values on the stack
+    uint8_t op_code;
+    uint8_t top_type;   // the type of the top value, null if the stack is empty
+    uint16_t reserved;
+    uint32_t top;       // the top value's bits, or the length of a string
+};
+
+static_assert(sizeof(TraceRecord) == 16, "trace records should be 16 bytes");
+
+class TraceWriter{
+    private:
+        std::ofstream _file;
+        std::vector<TraceRecord> _block;
+        size_t _used {0};
+        void _write_block();
+    public:
+        // creates the trace file and writes the labels of the program being traced, throws an error if it can't be written
+        TraceWriter(const std::string& path, const std::vector<ProgramLabel>& labels);
+        TraceWriter(const TraceWriter&) = delete;
+        TraceWriter& operator=(const TraceWriter&) = delete;
+        ~TraceWriter();
+        void record(size_t address, InstructionType op_code, size_t depth, const Value* top);
+        // writes any records left in the block, throws an error if the file couldn't be written
+        void close();
+};
+
+inline void TraceWriter::record(size_t address, InstructionType op_code, size_t depth, const Value* top){
+    TraceRecord& rec = this->_block[this->_used];
+    rec.address = address;
+    rec.depth = depth;
+    rec.op_code = static_cast<uint8_t>(op_code);
+    rec.top_type = static_cast<uint8_t>(ValueType::TYPE_NULL);
+    rec.top = 0;
+    if (top != nullptr){
+        ValueType type = top->get_type();
+        rec.top_type = static_cast<uint8_t>(type);
+        if (type == ValueType::TYPE_STR || type == ValueType::TYPE_NAME)
+            rec.top = top->get_str().size();
+        else if (type == ValueType::TYPE_FLOAT){
+            float float_val = top->get_float();
+            std::memcpy(&rec.top, &float_val, sizeof(float));
+        }
+        else if (type != ValueType::TYPE_NULL)
+            rec.top = static_cast<uint32_t>(top->get_int());
+    }
+    if (++this->_used == this->_block.size())
+        this->_write_block();
+}
+
+// prints the op codes, jumps and call tree of a trace, or every record if dump is set, throws an error if the trace isn't valid
+void report_trace(std::ostream& out, std::string_view bytes, bool dump = false);
+
+#endif
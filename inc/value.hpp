@@ -2,10 +2,14 @@
 #define VALUE_H
 
 #include <string>
-#include <variant>
+#include <string_view>
+#include <cstdint>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
 #include <stdexcept>
 
-enum class ValueType{
+enum class ValueType : uint8_t{
     TYPE_INT,
     TYPE_FLOAT,
     TYPE_BOOL,
@@ -16,44 +20,119 @@ enum class ValueType{
     TYPE_NULL,
 };
 
+// the number of value types
+constexpr size_t VALUE_TYPE_COUNT {static_cast<size_t>(ValueType::TYPE_NULL) + 1};
+
+// the ways a float can be written as text
+enum class FloatFormat{
+    FLOAT_FIXED,        // six decimal places, as printf's %f
+    FLOAT_SHORTEST      // the fewest digits that read back as the same float
+};
+
+// the most characters format_scalar writes, enough for any int, and any float in fixed notation
+constexpr size_t MAX_SCALAR_CHARS {64};
+
+// the properties of a value type, type queries read these rather than testing against lists of types
+struct TypeTraits{
+    const char* name;
+    bool integral;      // stored in the integer field, these can be used with logical and ordered comparison operations
+    bool numeric;       // can be used with arithmetic operations
+    bool collection;    // can be indexed, and has a length
+};
+
+// the properties of each value type, indexed by their numeric enum values
+inline constexpr TypeTraits TYPE_TRAITS[] {
+    {"int", true, true, false},
+    {"float", false, true, false},
+    {"bool", true, false, false},
+    {"char", true, false, false},
+    {"string", false, false, true},
+    {"name", false, false, false},
+    {"type", false, false, false},
+    {"null", false, false, false}
+};
+
+static_assert(std::size(TYPE_TRAITS) == VALUE_TYPE_COUNT, "every value type needs its traits");
+
+constexpr const TypeTraits& type_traits(ValueType type){
+    return TYPE_TRAITS[static_cast<size_t>(type)];
+}
+
+// a reference counted, immutable string shared between every copy of a string Value
+struct StrObj{
+    size_t refs;
+    std::string str;
+};
+
+/*
+    the bytes of every string Value created so far on this thread. this isn't owned by any one interpreter, so the
+    interpreter takes the difference across each run to report in its statistics. it's kept per thread so interpreters
+    running on different threads don't race on it, or count each other's strings
+*/
+inline thread_local uint64_t string_bytes_allocated {0};
+
+/*
+    a tagged union of every value type, scalars are stored inline and strings are stored behind a pointer,
+    so every Value (and so every stack slot) is at most 16 bytes. ints, bools, chars and value types all
+    share the integer field, which lets integral conversions read it directly.
+*/
 class Value{
     private:
         ValueType _type;
-        std::variant<int, float, bool, char, std::string> _val;
+        union{
+            int _int;
+            float _float;
+            StrObj* _str;
+        };
+        bool _has_str() const {return this->_type == ValueType::TYPE_STR || this->_type == ValueType::TYPE_NAME;}
+        void _release();
     public:
-        Value() : _type(ValueType::TYPE_NULL) {}
+        Value() : _type(ValueType::TYPE_NULL), _str(nullptr) {}
         template <typename T>
         Value(ValueType type, const T& value);
-        template <typename T>
-        void set_value(const T& value);
-        const std::variant<int, float, bool, char, std::string>& get_value() const {return this->_val;}
+        Value(const Value& other);
+        Value(Value&& other) noexcept;
+        Value& operator=(const Value& other);
+        Value& operator=(Value&& other) noexcept;
+        ~Value() {this->_release();}
+        ValueType get_type() const {return this->_type;}
+        int get_int() const {return this->_int;}
+        float get_float() const {return this->_float;}
+        const std::string& get_str() const {return this->_str->str;}
         int as_int() const;
         static Value from_int(ValueType type, int val);
-        ~Value(){};
-        ValueType get_type() const {return this->_type;}
-        std::string to_string() const;
+        std::string to_string(FloatFormat format = FloatFormat::FLOAT_FIXED) const;
+        // writes the text of a value without a string to out, which must have room for MAX_SCALAR_CHARS, and returns the end of the text
+        char* format_scalar(char* out, FloatFormat format = FloatFormat::FLOAT_FIXED) const;
         bool as_bool() const;
         char as_char() const;
         Value get_index(size_t index) const;
         size_t get_len() const;
-        bool is_intergral() const;
-        bool is_collection() const;
-        bool operator==(const Value& rhs);
-        bool operator!=(const Value& rhs);
-        bool operator>(const Value& rhs);
+        bool is_intergral() const {return type_traits(this->_type).integral;}
+        bool is_collection() const {return type_traits(this->_type).collection;}
+        bool operator==(const Value& rhs) const;
+        bool operator!=(const Value& rhs) const;
+        bool operator>(const Value& rhs) const;
+        // the layout of a value in memory, used by the JIT
+        static constexpr size_t type_offset() {return offsetof(Value, _type);}
+        static constexpr size_t data_offset() {return offsetof(Value, _int);}
 };
 
-template <typename T>
-Value::Value(ValueType type, const T& value){
-    this->_type = type;
-    this->set_value(value);
-}
+static_assert(sizeof(Value) <= 16, "Value should fit in 16 bytes");
 
+// the storage used is picked from the type, so a value of any C++ type can be stored as any compatible Evo type
 template <typename T>
-void Value::set_value(const T& value){
-    this->_val = value;
+Value::Value(ValueType type, const T& value) : _type(type), _str(nullptr){
+    if constexpr (std::is_convertible_v<const T&, std::string_view>){
+        if (this->_has_str()){
+            this->_str = new StrObj{1, std::string(std::string_view(value))};
+            string_bytes_allocated += this->_str->str.size();
+        }
+    }
+    else if (type == ValueType::TYPE_FLOAT)
+        this->_float = static_cast<float>(value);
+    else
+        this->_int = static_cast<int>(value);
 }
 
-
-
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,42 @@
+#ifndef VALUE_STACK_H
+#define VALUE_STACK_H
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include "../inc/value.hpp"
+
+/*
+    the interpreter's stack, a fixed capacity array of values. the capacity is the interpreter's stack limit, so
+    values never move once pushed, and the layout is fixed so native code from the JIT can push and pop values
+    directly. callers must check there's room before pushing a value.
+*/
+class ValueStack{
+    private:
+        Value* _data {nullptr};
+        size_t _size {0};
+        size_t _capacity {0};
+    public:
+        ValueStack() {}
+        ValueStack(const ValueStack&) = delete;
+        ValueStack& operator=(const ValueStack&) = delete;
+        ~ValueStack();
+        void set_capacity(size_t capacity);
+        size_t capacity() const {return this->_capacity;}
+        size_t size() const {return this->_size;}
+        bool empty() const {return this->_size == 0;}
+        Value* data() {return this->_data;}
+        Value& operator[](size_t index) {return this->_data[index];}
+        Value& back() {return this->_data[this->_size - 1];}
+        void push_back(const Value& val) {new (&this->_data[this->_size++]) Value(val);}
+        void push_back(Value&& val) {new (&this->_data[this->_size++]) Value(std::move(val));}
+        void pop_back() {this->_data[--this->_size].~Value();}
+        void resize(size_t size);
+        void clear() {this->resize(0);}
+        // the layout of the stack in memory, used by the JIT
+        static constexpr size_t data_offset() {return offsetof(ValueStack, _data);}
+        static constexpr size_t size_offset() {return offsetof(ValueStack, _size);}
+        static constexpr size_t capacity_offset() {return offsetof(ValueStack, _capacity);}
+};
+
+#endif
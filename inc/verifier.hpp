@@ -0,0 +1,21 @@
+#ifndef VERIFIER_H
+#define VERIFIER_H
+
+#include <vector>
+#include "../inc/instruction.hpp"
+
+/*
+    the verifier walks every path through a program's control flow graph, tracking the minimum depth of the stack
+    and, where they can be known, the types of the values near the top of it. instructions whose stack depth and
+    operand type checks are proven to pass on every path are marked as verified, so the interpreter can run them
+    without those checks. checks that depend on the values themselves (division by zero, index ranges, stack
+    overflow, undeclared variables) are never removed.
+*/
+
+// the number of values from the top of the stack whose types are tracked
+const size_t VERIFIER_TRACKED_TYPES {8};
+
+// verifies a program that starts running with entry_depth values already on the stack
+void verify_bytecode(std::vector<Instruction>& instructions, size_t entry_depth = 0);
+
+#endif
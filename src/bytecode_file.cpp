@@ -0,0 +1,306 @@
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <format>
+#include <fstream>
+#include <filesystem>
+#include <unordered_map>
+#include <random>
+#include <stdexcept>
+#include "../inc/value.hpp"
+#include "../inc/instruction.hpp"
+#include "../inc/bytecode_file.hpp"
+
+// the layout of each part of a .evoc file
+struct FileHeader{
+    char magic[4];
+    uint32_t version;
+    uint64_t source_hash;
+    uint32_t inst_count;
+    uint32_t const_count;
+    uint32_t var_count;
+    uint32_t label_count;
+    uint32_t line_count;
+    uint32_t string_size;
+};
+
+struct FileInstruction{
+    uint8_t op_code;
+    uint8_t has_arg;
+    uint16_t reserved;
+    int32_t aux;
+    uint32_t arg;       // the index of the argument in the constant pool
+};
+
+struct FileConstant{
+    uint8_t type;
+    uint8_t reserved[3];
+    uint32_t data;      // the value's bits, or the offset of a string's bytes
+    uint32_t length;    // the length of a string
+};
+
+struct FileString{
+    uint32_t offset;
+    uint32_t length;
+};
+
+struct FileLabel{
+    FileString name;
+    uint32_t address;
+};
+
+const char EVOC_MAGIC[4] {'E', 'V', 'O', 'C'};
+
+static bool has_str(ValueType type){
+    return type == ValueType::TYPE_STR || type == ValueType::TYPE_NAME;
+}
+
+// FNV-1a, continuing from the given hash
+static uint64_t fnv1a(std::string_view bytes, uint64_t hash = 14695981039346656037ull){
+    for (char chr : bytes){
+        hash ^= static_cast<uint8_t>(chr);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+uint64_t hash_source(std::string_view source, bool optimize){
+    uint64_t hash = fnv1a(source);
+    std::string options = std::format("evoc {} {}", EVOC_VERSION, optimize ? "-O" : "");
+    return fnv1a(options, hash);
+}
+
+// appends the bytes of a trivially copyable value to a buffer
+template <typename T>
+static void append(std::string& out, const T& value){
+    out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// builds the constant pool and string bytes, giving every distinct value a single entry
+class ConstantPool{
+    private:
+        std::unordered_map<std::string, uint32_t> _indexes;
+    public:
+        std::vector<FileConstant> constants;
+        std::string strings;
+        FileString add_string(std::string_view str){
+            FileString entry{static_cast<uint32_t>(this->strings.size()), static_cast<uint32_t>(str.size())};
+            this->strings.append(str);
+            return entry;
+        }
+        uint32_t add(const Value& val){
+            FileConstant constant{};
+            constant.type = static_cast<uint8_t>(val.get_type());
+            // the key is the type followed by either the value's bits or its string
+            std::string key(1, static_cast<char>(constant.type));
+            if (has_str(val.get_type()))
+                key += val.get_str();
+            else if (val.get_type() == ValueType::TYPE_FLOAT){
+                float float_val = val.get_float();
+                std::memcpy(&constant.data, &float_val, sizeof(float));
+                append(key, constant.data);
+            }
+            else if (val.get_type() != ValueType::TYPE_NULL){
+                constant.data = static_cast<uint32_t>(val.get_int());
+                append(key, constant.data);
+            }
+            auto [entry, inserted] = this->_indexes.try_emplace(key, static_cast<uint32_t>(this->constants.size()));
+            if (inserted){
+                if (has_str(val.get_type())){
+                    FileString str = this->add_string(val.get_str());
+                    constant.data = str.offset;
+                    constant.length = str.length;
+                }
+                this->constants.push_back(constant);
+            }
+            return entry->second;
+        }
+};
+
+std::string serialize_program(const CompiledProgram& program){
+    ConstantPool pool;
+    std::vector<FileInstruction> instructions;
+    instructions.reserve(program.instructions.size());
+    for (const Instruction& inst : program.instructions){
+        FileInstruction file_inst{};
+        file_inst.op_code = static_cast<uint8_t>(inst.op_code);
+        file_inst.aux = inst.aux;
+        if (inst.arg.has_value()){
+            file_inst.has_arg = 1;
+            file_inst.arg = pool.add(inst.arg.value());
+        }
+        instructions.push_back(file_inst);
+    }
+    std::vector<FileString> var_names;
+    for (const std::string& name : program.var_names)
+        var_names.push_back(pool.add_string(name));
+    std::vector<FileLabel> labels;
+    for (const ProgramLabel& label : program.labels)
+        labels.push_back({pool.add_string(label.name), static_cast<uint32_t>(label.address)});
+    FileHeader header{};
+    std::memcpy(header.magic, EVOC_MAGIC, sizeof(EVOC_MAGIC));
+    header.version = EVOC_VERSION;
+    header.source_hash = program.source_hash;
+    header.inst_count = instructions.size();
+    header.const_count = pool.constants.size();
+    header.var_count = var_names.size();
+    header.label_count = labels.size();
+    header.line_count = program.lines.size();
+    header.string_size = pool.strings.size();
+    std::string out;
+    out.reserve(sizeof(FileHeader) + instructions.size() * sizeof(FileInstruction) + pool.constants.size() * sizeof(FileConstant) + var_names.size() * sizeof(FileString) + labels.size() * sizeof(FileLabel) + program.lines.size() * sizeof(LineEntry) + pool.strings.size());
+    append(out, header);
+    out.append(reinterpret_cast<const char*>(instructions.data()), instructions.size() * sizeof(FileInstruction));
+    out.append(reinterpret_cast<const char*>(pool.constants.data()), pool.constants.size() * sizeof(FileConstant));
+    out.append(reinterpret_cast<const char*>(var_names.data()), var_names.size() * sizeof(FileString));
+    out.append(reinterpret_cast<const char*>(labels.data()), labels.size() * sizeof(FileLabel));
+    out.append(reinterpret_cast<const char*>(program.lines.data()), program.lines.size() * sizeof(LineEntry));
+    out.append(pool.strings);
+    return out;
+}
+
+// reads the count entries of a section starting at offset, the file's size has already been checked
+template <typename T>
+static std::vector<T> read_section(std::string_view bytes, size_t offset, size_t count){
+    std::vector<T> section(count);
+    // an empty vector's data may be null, which memcpy can't be given even to copy nothing
+    if (count != 0)
+        std::memcpy(section.data(), bytes.data() + offset, count * sizeof(T));
+    return section;
+}
+
+CompiledProgram load_program(std::string_view bytes){
+    const std::runtime_error invalid("Invalid bytecode file");
+    FileHeader header;
+    if (bytes.size() < sizeof(FileHeader))
+        throw invalid;
+    std::memcpy(&header, bytes.data(), sizeof(FileHeader));
+    if (std::memcmp(header.magic, EVOC_MAGIC, sizeof(EVOC_MAGIC)) != 0)
+        throw invalid;
+    if (header.version != EVOC_VERSION)
+        throw std::runtime_error(std::format("Bytecode file is version {}, but this version of evo reads version {}, recompile it", header.version, EVOC_VERSION));
+    // every count is 32 bits, so these sums can't overflow
+    uint64_t inst_offset = sizeof(FileHeader);
+    uint64_t const_offset = inst_offset + uint64_t(header.inst_count) * sizeof(FileInstruction);
+    uint64_t var_offset = const_offset + uint64_t(header.const_count) * sizeof(FileConstant);
+    uint64_t label_offset = var_offset + uint64_t(header.var_count) * sizeof(FileString);
+    uint64_t line_offset = label_offset + uint64_t(header.label_count) * sizeof(FileLabel);
+    uint64_t string_offset = line_offset + uint64_t(header.line_count) * sizeof(LineEntry);
+    if (string_offset + header.string_size != bytes.size())
+        throw invalid;
+    std::string_view strings = bytes.substr(string_offset);
+    // returns a string from the string bytes, after checking that it's in range
+    auto get_string = [&](uint32_t offset, uint32_t length){
+        if (uint64_t(offset) + length > strings.size())
+            throw invalid;
+        return strings.substr(offset, length);
+    };
+    CompiledProgram program;
+    program.source_hash = header.source_hash;
+    std::vector<Value> constants;
+    constants.reserve(header.const_count);
+    for (const FileConstant& constant : read_section<FileConstant>(bytes, const_offset, header.const_count)){
+        if (constant.type > static_cast<uint8_t>(ValueType::TYPE_NULL))
+            throw invalid;
+        ValueType type = static_cast<ValueType>(constant.type);
+        if (has_str(type))
+            constants.emplace_back(type, get_string(constant.data, constant.length));
+        else if (type == ValueType::TYPE_FLOAT){
+            float float_val;
+            std::memcpy(&float_val, &constant.data, sizeof(float));
+            constants.emplace_back(type, float_val);
+        }
+        // a value type must name one of the types, as it indexes the type tables
+        else if (type == ValueType::TYPE_VALTYPE && constant.data >= VALUE_TYPE_COUNT)
+            throw invalid;
+        else
+            constants.emplace_back(type, static_cast<int>(constant.data));
+    }
+    program.instructions.reserve(header.inst_count);
+    for (const FileInstruction& file_inst : read_section<FileInstruction>(bytes, inst_offset, header.inst_count)){
+        // quickened op codes are only made while running, so they're never saved
+        if (file_inst.op_code >= static_cast<uint8_t>(InstructionType::INST_ADD_INT))
+            throw invalid;
+        InstructionType op_code = static_cast<InstructionType>(file_inst.op_code);
+        bool uses_slot = op_code == InstructionType::INST_GET || op_code == InstructionType::INST_SET;
+        // the variable an increment adds to is kept in its aux, and must be one of the program's variables
+        if (op_code == InstructionType::INST_INC_VAR && (file_inst.aux < 0 || uint32_t(file_inst.aux) >= header.var_count))
+            throw invalid;
+        if (!file_inst.has_arg){
+            if (is_jump(op_code) || uses_slot || op_code == InstructionType::INST_INC_VAR || op_code == InstructionType::INST_ADD_IMM)
+                throw invalid;
+            program.instructions.emplace_back(op_code);
+            program.instructions.back().aux = file_inst.aux;
+            continue;
+        }
+        if (file_inst.arg >= constants.size())
+            throw invalid;
+        const Value& arg = constants[file_inst.arg];
+        // every jump must land inside the program, or just past its end
+        if (is_jump(op_code) && (arg.get_type() != ValueType::TYPE_INT || arg.get_int() < 0 || uint32_t(arg.get_int()) > header.inst_count))
+            throw invalid;
+        // and every variable slot must be one of the program's variables
+        if (uses_slot && (arg.get_type() != ValueType::TYPE_INT || arg.get_int() < 0 || uint32_t(arg.get_int()) >= header.var_count))
+            throw invalid;
+        program.instructions.emplace_back(op_code, arg, file_inst.aux);
+    }
+    program.var_names.reserve(header.var_count);
+    for (const FileString& name : read_section<FileString>(bytes, var_offset, header.var_count))
+        program.var_names.emplace_back(get_string(name.offset, name.length));
+    program.labels.reserve(header.label_count);
+    for (const FileLabel& label : read_section<FileLabel>(bytes, label_offset, header.label_count)){
+        // a label may mark the end of the program, and the labels must stay sorted
+        if (label.address > header.inst_count || (!program.labels.empty() && label.address < program.labels.back().address))
+            throw invalid;
+        program.labels.push_back({std::string(get_string(label.name.offset, label.name.length)), label.address});
+    }
+    program.lines = read_section<LineEntry>(bytes, line_offset, header.line_count);
+    for (size_t i = 0; i < program.lines.size(); i++)
+        if (program.lines[i].address > header.inst_count || (i && program.lines[i].address <= program.lines[i - 1].address))
+            throw invalid;
+    return program;
+}
+
+bool save_program(const CompiledProgram& program, const std::string& path){
+    std::string bytes = serialize_program(program);
+    // write to a temporary file first, so a concurrent reader never sees a partly written file
+    std::string tmp_path = std::format("{}.tmp{}", path, std::random_device{}());
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file.good())
+            return false;
+        file.write(bytes.data(), bytes.size());
+        if (!file.good()){
+            file.close();
+            std::remove(tmp_path.c_str());
+            return false;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(tmp_path, path, error);
+    if (error){
+        std::remove(tmp_path.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string cache_path(uint64_t source_hash){
+    std::filesystem::path dir;
+    if (const char* evo_cache = std::getenv("EVO_CACHE_DIR"))
+        dir = evo_cache;
+    else if (const char* xdg_cache = std::getenv("XDG_CACHE_HOME"))
+        dir = std::filesystem::path(xdg_cache) / "evo";
+    else if (const char* home = std::getenv("HOME"))
+        dir = std::filesystem::path(home) / ".cache" / "evo";
+    else
+        return "";
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+    if (error)
+        return "";
+    return (dir / std::format("{:016x}.evoc", source_hash)).string();
+}
@@ -1,4 +1,8 @@
 #include <optional>
+#include <vector>
+#include <algorithm>
+#include <iterator>
+#include <string_view>
 #include "../inc/value.hpp"
 #include "../inc/instruction.hpp"
 
@@ -9,4 +13,132 @@ Instruction::Instruction(InstructionType op_code){
 Instruction::Instruction(InstructionType op_code, const Value& arg_val){
     this->op_code = op_code;
     this->arg = arg_val;
-}
\ No newline at end of file
+}
+
+Instruction::Instruction(InstructionType op_code, const Value& arg_val, int aux){
+    this->op_code = op_code;
+    this->arg = arg_val;
+    this->aux = aux;
+}
+
+size_t line_of(const std::vector<LineEntry>& lines, size_t address){
+    auto after = std::upper_bound(lines.begin(), lines.end(), address, [](size_t addr, const LineEntry& entry){return addr < entry.address;});
+    if (after == lines.begin())
+        return 0;
+    return std::prev(after)->line;
+}
+
+const ProgramLabel* label_of(const std::vector<ProgramLabel>& labels, size_t address){
+    auto after = std::upper_bound(labels.begin(), labels.end(), address, [](size_t addr, const ProgramLabel& label){return addr < label.address;});
+    if (after == labels.begin())
+        return nullptr;
+    return &*std::prev(after);
+}
+
+// returns true if the instruction's argument is the address of another instruction
+bool is_jump(InstructionType op_code){
+    switch (op_code){
+        case InstructionType::INST_JUMP:
+        case InstructionType::INST_JUMPIF:
+        case InstructionType::INST_CALL:
+        case InstructionType::INST_JUMP_NEQ:
+        case InstructionType::INST_JUMP_EQ:
+        case InstructionType::INST_JUMP_LESS:
+        case InstructionType::INST_JUMP_GREATER:
+        case InstructionType::INST_JUMP_LESS_EQ:
+        case InstructionType::INST_JUMP_GREATER_EQ:
+        case InstructionType::INST_JUMP_NEQ_INT:
+        case InstructionType::INST_JUMP_EQ_INT:
+        case InstructionType::INST_JUMP_LESS_INT:
+        case InstructionType::INST_JUMP_GREATER_INT:
+        case InstructionType::INST_JUMP_LESS_EQ_INT:
+        case InstructionType::INST_JUMP_GREATER_EQ_INT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+/*
+    quickened op codes are laid out in the same order as the op codes they specialize, so one is found from the other
+    by moving an op code from the start of one group to the start of the other
+*/
+static InstructionType move_op(InstructionType op_code, InstructionType from, InstructionType to){
+    return static_cast<InstructionType>(static_cast<int>(to) + static_cast<int>(op_code) - static_cast<int>(from));
+}
+
+InstructionType quickened_op(InstructionType op_code, ValueType left, ValueType right){
+    if (left != right)
+        return op_code;
+    switch (op_code){
+        case InstructionType::INST_ADD:
+        case InstructionType::INST_SUB:
+        case InstructionType::INST_MUL:
+        case InstructionType::INST_DIV:
+        case InstructionType::INST_MOD:
+            if (left == ValueType::TYPE_INT)
+                return move_op(op_code, InstructionType::INST_ADD, InstructionType::INST_ADD_INT);
+            // there is no float modulo, so that error is left to the generic handler
+            if (left == ValueType::TYPE_FLOAT && op_code != InstructionType::INST_MOD)
+                return move_op(op_code, InstructionType::INST_ADD, InstructionType::INST_ADD_FLOAT);
+            return op_code;
+        case InstructionType::INST_NEQ:
+        case InstructionType::INST_EQ:
+            if (left == ValueType::TYPE_CHAR)
+                return move_op(op_code, InstructionType::INST_NEQ, InstructionType::INST_NEQ_CHAR);
+            [[fallthrough]];
+        case InstructionType::INST_LESS:
+        case InstructionType::INST_GREATER:
+        case InstructionType::INST_LESS_EQ:
+        case InstructionType::INST_GREATER_EQ:
+            if (left == ValueType::TYPE_INT)
+                return move_op(op_code, InstructionType::INST_NEQ, InstructionType::INST_NEQ_INT);
+            return op_code;
+        case InstructionType::INST_JUMP_NEQ:
+        case InstructionType::INST_JUMP_EQ:
+        case InstructionType::INST_JUMP_LESS:
+        case InstructionType::INST_JUMP_GREATER:
+        case InstructionType::INST_JUMP_LESS_EQ:
+        case InstructionType::INST_JUMP_GREATER_EQ:
+            if (left == ValueType::TYPE_INT)
+                return move_op(op_code, InstructionType::INST_JUMP_NEQ, InstructionType::INST_JUMP_NEQ_INT);
+            return op_code;
+        default:
+            return op_code;
+    }
+}
+
+InstructionType generic_op(InstructionType op_code){
+    if (op_code >= InstructionType::INST_JUMP_NEQ_INT)
+        return move_op(op_code, InstructionType::INST_JUMP_NEQ_INT, InstructionType::INST_JUMP_NEQ);
+    if (op_code >= InstructionType::INST_NEQ_CHAR)
+        return move_op(op_code, InstructionType::INST_NEQ_CHAR, InstructionType::INST_NEQ);
+    if (op_code >= InstructionType::INST_NEQ_INT)
+        return move_op(op_code, InstructionType::INST_NEQ_INT, InstructionType::INST_NEQ);
+    if (op_code >= InstructionType::INST_ADD_FLOAT)
+        return move_op(op_code, InstructionType::INST_ADD_FLOAT, InstructionType::INST_ADD);
+    if (op_code >= InstructionType::INST_ADD_INT)
+        return move_op(op_code, InstructionType::INST_ADD_INT, InstructionType::INST_ADD);
+    return op_code;
+}
+
+// the name of every op code, in op code order. instructions are named by their keywords, and superinstructions and quickened instructions by what they do
+constexpr std::string_view OP_NAMES[] {
+    "null", "push", "pop", "clear", "peek", "swap", "size", "dup",
+    "add", "sub", "mul", "div", "mod", "and", "or", "xor", "not",
+    "neq", "eq", "lt", "gt", "lte", "gte",
+    "j", "jif", "call", "ret", "get", "set", "print", "println", "read", "readint", "flush",
+    "at", "len", "type", "conv", "?",
+    "j!=", "j==", "j<", "j>", "j<=", "j>=", "inc_var", "add_imm", "print_p", "println_p",
+    "add_int", "sub_int", "mul_int", "div_int", "mod_int",
+    "add_float", "sub_float", "mul_float", "div_float",
+    "neq_int", "eq_int", "lt_int", "gt_int", "lte_int", "gte_int", "neq_char", "eq_char",
+    "j!=_int", "j==_int", "j<_int", "j>_int", "j<=_int", "j>=_int"
+};
+static_assert(std::size(OP_NAMES) == static_cast<size_t>(InstructionType::INST_COUNT), "every op code needs a name");
+
+std::string_view op_name(InstructionType op_code){
+    if (op_code >= InstructionType::INST_COUNT)
+        return "unknown";
+    return OP_NAMES[static_cast<size_t>(op_code)];
+}
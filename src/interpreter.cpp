@@ -4,24 +4,54 @@
 #include <sstream>
 #include <stdexcept>
 #include <format>
+#include <algorithm>
+#include <chrono>
 #include "../inc/parser.hpp"
 #include "../inc/value.hpp"
+#include "../inc/value_stack.hpp"
 #include "../inc/lexer.hpp"
 #include "../inc/instruction.hpp"
+#include "../inc/operations.hpp"
+#include "../inc/verifier.hpp"
+#include "../inc/jit.hpp"
+#include "../inc/register_vm.hpp"
 #include "../inc/interpreter.hpp"
 
+Interpreter::Interpreter(size_t max_stack){
+    this->set_max_stack(max_stack);
+}
+
 // STACK INSTRUCTIONS FOLLOW
+// sets the maximum depth of the stack, and preallocates space for all of it so the stack never reallocates
+void Interpreter::set_max_stack(size_t max_stack){
+    if (max_stack < this->_stack.size())
+        throw std::runtime_error(std::format("Stack Error: the stack already holds more than {} values", max_stack));
+    this->_stack.set_capacity(max_stack);
+}
+
+// raises an error if there is no room on the stack for another value
+void Interpreter::_check_overflow(){
+    if (this->_stack.size() >= this->_stack.capacity())
+        throw std::runtime_error(std::format("Stack Error on line {}: stack overflow, the stack is limited to {} values", this->_current_line(), this->_stack.capacity()));
+}
+
 // pushes a value on to the top of stack
 void Interpreter::stack_push(const Value& val){
+    this->_check_overflow();
     this->_stack.push_back(val);
 }
 
+void Interpreter::stack_push(Value&& val){
+    this->_check_overflow();
+    this->_stack.push_back(std::move(val));
+}
+
 // duplicates the top value of the stack
 void Interpreter::stack_dup(){
     if (this->_stack.empty())
-        throw std::runtime_error(std::format("Error on line {}: cannot retrieve a value from an empty stack.", this->_line_no));
-    Value val = this->_stack.back();
-    this->_stack.push_back(val);
+        throw std::runtime_error(std::format("Error on line {}: cannot retrieve a value from an empty stack.", this->_current_line()));
+    this->_check_overflow();
+    this->_stack.push_back(this->_stack.back());
 }
 
 // CALL STACK FUNTIONS FOLLOW
@@ -36,60 +66,81 @@ size_t Interpreter::_pop_return(){
 
 void Interpreter::_push_return(size_t addr){
     this->_return_addrs.push_back(addr);
+    this->_stats.peak_calls = std::max(this->_stats.peak_calls, this->_return_addrs.size());
 }
 
 // returns a constant reference to the top value of the stack
 const Value& Interpreter::stack_top(){
     if (this->_stack.empty())
-        throw std::runtime_error(std::format("Error on line {}: cannot retrieve a value from an empty stack.", this->_line_no));
+        throw std::runtime_error(std::format("Error on line {}: cannot retrieve a value from an empty stack.", this->_current_line()));
     return this->_stack.back();
 }
 
 // pops the top value off the stack and returns it
 Value Interpreter::stack_pop(){
     if (this->_stack.empty())
-        throw std::runtime_error(std::format("Error on line {}: cannot retrieve a value from an empty stack.", this->_line_no));
-    Value val = this->_stack.back();
+        throw std::runtime_error(std::format("Error on line {}: cannot retrieve a value from an empty stack.", this->_current_line()));
+    Value val = std::move(this->_stack.back());
     this->_stack.pop_back();
     return val;
 }
 
 // PROGRAM INSTRUCTIONS FOLLOW
+// pushes an instruction's argument to the stack
+void Interpreter::_push_op(const Instruction& inst){
+    if (!inst.arg.has_value())
+        throw std::runtime_error(std::format("Error on line {}: illegal instruction", this->_current_line()));
+    this->stack_push(inst.arg.value());
+}
+
+// discards the top value of the stack
+template <bool CHECKED>
+void Interpreter::_pop_op(){
+    if (CHECKED && this->_stack.empty())
+        throw std::runtime_error(std::format("Error on line {}: cannot retrieve a value from an empty stack.", this->_current_line()));
+    this->_stack.pop_back();
+}
+
+// swaps the top and second to top values of the stack
+template <bool CHECKED>
+void Interpreter::_swap_op(){
+    if (CHECKED && this->_stack.size() < 2)
+        throw std::runtime_error(std::format("Stack Error on line {}: The 'swap' command needs at least two values on the stack", this->_current_line()));
+    std::swap(this->_stack.back(), this->_stack[this->_stack.size() - 2]);
+}
+
+// pushes a copy of the value a given number of places below the top of the stack
+void Interpreter::_peek_op(){
+    if (this->_stack.size() < 2)
+        throw std::runtime_error(std::format("Stack Error on line {}: The 'swap' command needs at least two values on the stack", this->_current_line()));
+    // the index is replaced by the value it refers to, so the size excluding the index is used for the range check
+    Value& arg = this->_stack.back();
+    size_t size = this->_stack.size() - 1;
+    if (arg.get_type() != ValueType::TYPE_INT)
+        throw std::runtime_error(std::format("Value Error on line {}: Invalid value type for peek index", this->_current_line()));
+    int index = arg.get_int();
+    if (index >= size)
+        throw std::runtime_error(std::format("Range Error on line {}: Index for peek instruction out of range", this->_current_line()));
+    arg = this->_stack[size - (1 + index)];
+}
+
 // runs a stack manipulation operation
 void Interpreter::_stack_op(const Instruction& inst){
-    Value top, second, arg;
-    int index;
     switch (inst.op_code){
         case InstructionType::INST_POP:
-            this->stack_pop();
+            this->_pop_op();
             break;
         case InstructionType::INST_DUP:
             this->stack_dup();
             break;
         case InstructionType::INST_PUSH:
-            if (!inst.arg.has_value())
-                throw std::runtime_error(std::format("Error on line {}: illegal instruction", this->_line_no));
-            this->stack_push(inst.arg.value());
+            this->_push_op(inst);
             break;
         case InstructionType::INST_SWAP:
-            if (this->_stack.size() < 2)
-                throw std::runtime_error(std::format("Stack Error on line {}: The 'swap' command needs at least two values on the stack", this->_line_no));
-            // swap the top and second to top values
-            top = this->stack_pop();
-            second = this->stack_pop();
-            this->stack_push(top);
-            this->stack_push(second);
+            this->_swap_op();
             break;
         case InstructionType::INST_PEEK:
-            if (this->_stack.size() < 2)
-                throw std::runtime_error(std::format("Stack Error on line {}: The 'swap' command needs at least two values on the stack", this->_line_no));
-            arg = this->stack_pop();
-            if (arg.get_type() != ValueType::TYPE_INT)
-                throw std::runtime_error(std::format("Value Error on line {}: Invalid value type for peek index", this->_line_no));
-            index = std::get<int>(arg.get_value());
-            if (index >= this->_stack.size())
-                throw std::runtime_error(std::format("Range Error on line {}: Index for peek instruction out of range", this->_line_no));
-            this->stack_push(this->_stack[this->_stack.size() - (1 + index)]);
+            this->_peek_op();
             break;
         case InstructionType::INST_SIZE:
             this->stack_push(Value(ValueType::TYPE_INT, static_cast<int>(this->_stack.size())));
@@ -100,331 +151,453 @@ void Interpreter::_stack_op(const Instruction& inst){
     }
 }
 
+// applies an arithmetic operation to two values, storing the result in the left value
+template <InstructionType OP, bool CHECKED>
+void Interpreter::_arith_values(Value& left_val, const Value& right_val){
+    try{
+        arith_values<OP, CHECKED>(left_val, right_val);
+    }
+    catch (const std::runtime_error& e){
+        throw std::runtime_error(std::format("Error on line {}: {}", this->_current_line(), e.what()));
+    }
+}
+
+// runs a single arithmetic operation
+template <InstructionType OP, bool CHECKED>
+void Interpreter::_arith(){
+    // ensure there at least two values on the stack to pop
+    if (CHECKED && this->_stack.size() < 2)
+        throw std::runtime_error(std::format("Error on line {}: arithmetic operations require at least two values on the stack", this->_current_line()));
+    // the result overwrites the left value in place, and the right value is popped
+    this->_arith_values<OP, CHECKED>(this->_stack[this->_stack.size() - 2], this->_stack.back());
+    this->_stack.pop_back();
+}
+
 // runs an arithmetic operation
 void Interpreter::_arith_op(const Instruction& inst){
+    switch (inst.op_code){
+        case InstructionType::INST_ADD: this->_arith<InstructionType::INST_ADD>(); break;
+        case InstructionType::INST_SUB: this->_arith<InstructionType::INST_SUB>(); break;
+        case InstructionType::INST_MUL: this->_arith<InstructionType::INST_MUL>(); break;
+        case InstructionType::INST_DIV: this->_arith<InstructionType::INST_DIV>(); break;
+        case InstructionType::INST_MOD: this->_arith<InstructionType::INST_MOD>(); break;
+    }
+}
+
+// runs a single logical operation
+template <InstructionType OP, bool CHECKED>
+void Interpreter::_logic(){
     // ensure there at least two values on the stack to pop
-    if (this->_stack.size() < 2)
-        throw std::runtime_error(std::format("Error on line {}: arithmetic operations require at least two values on the stack", this->_line_no));
-    Value right_val = this->stack_pop();
-    Value left_val = this->stack_pop();
-    // ensure values match and are of the right type
-    if (right_val.get_type() != left_val.get_type())
-        throw std::runtime_error(std::format("Error on line {}: arithmetic cannot be performed on mismatch types", this->_line_no));
-    if (right_val.get_type() != ValueType::TYPE_INT && right_val.get_type() != ValueType::TYPE_FLOAT)
-        throw std::runtime_error(std::format("Error on line {}: invalid type for arithmetic operation", this->_line_no));
-    // check if the values are float values
-    Value result;
-    if (right_val.get_type() == ValueType::TYPE_FLOAT){
-        result = this->_float_op(inst, std::get<float>(right_val.get_value()), std::get<float>(left_val.get_value()));
-        this->stack_push(result);
-        return;
+    if (CHECKED && this->_stack.size() < 2)
+        throw std::runtime_error(std::format("Error on line {}: logical operations require at least two values on the stack", this->_current_line()));
+    // the result overwrites the left value in place, and the right value is popped
+    try{
+        logic_values<OP, CHECKED>(this->_stack[this->_stack.size() - 2], this->_stack.back());
     }
-    int rhs {std::get<int>(right_val.get_value())}, lhs {std::get<int>(left_val.get_value())}, retval;
-    switch (inst.op_code){
-    case InstructionType::INST_ADD:
-        retval = lhs + rhs;
-        break;
-    case InstructionType::INST_SUB:
-        retval = lhs - rhs;
-        break;
-    case InstructionType::INST_MUL:
-        retval = lhs * rhs;
-        break;
-    case InstructionType::INST_DIV:
-        retval = lhs / rhs;
-        break;
-    case InstructionType::INST_MOD:
-        retval = lhs % rhs;
-        break;
-    }
-    result = Value(ValueType::TYPE_INT, retval);
-    this->stack_push(result);
-}
-
-// runs a floating point arithmetic expression
-Value Interpreter::_float_op(const Instruction& inst, float rhs, float lhs){
-    switch (inst.op_code){
-        case InstructionType::INST_ADD: return Value(ValueType::TYPE_FLOAT, lhs + rhs);
-        case InstructionType::INST_SUB: return Value(ValueType::TYPE_FLOAT, lhs - rhs);
-        case InstructionType::INST_MUL: return Value(ValueType::TYPE_FLOAT, lhs * rhs);
-        case InstructionType::INST_DIV: return Value(ValueType::TYPE_FLOAT, lhs / rhs);
+    catch (const std::runtime_error& e){
+        throw std::runtime_error(std::format("Error on line {}: {}", this->_current_line(), e.what()));
     }
+    this->_stack.pop_back();
 }
 
 // runs a logical operation
 void Interpreter::_logic_op(const Instruction& inst){
-    // ensure there at least two values on the stack to pop
-    if (this->_stack.size() < 2)
-        throw std::runtime_error(std::format("Error on line {}: logical operations require at least two values on the stack", this->_line_no));
-    Value right_val = this->stack_pop();
-    Value left_val = this->stack_pop();
-    // ensure values match and are of an integral type
-    if (right_val.get_type() != left_val.get_type())
-        throw std::runtime_error(std::format("Error on line {}: logical operations cannot be performed on mismatch types", this->_line_no));
-    if (!right_val.is_intergral())
-        throw std::runtime_error(std::format("Error on line {}: invalid type for logical operation", this->_line_no));
-    int lhs {left_val.as_int()}, rhs {right_val.as_int()}, retval;
-    bool eqval;
     switch (inst.op_code){
-        case InstructionType::INST_AND:
-            retval = lhs & rhs;
-            break;
-        case InstructionType::INST_OR:
-            retval = lhs | rhs;
-            break;
-        case InstructionType::INST_XOR:
-            retval = lhs ^ rhs;
-            break;
-    }  
-    this->stack_push(Value::from_int(left_val.get_type(), retval));
+        case InstructionType::INST_AND: this->_logic<InstructionType::INST_AND>(); break;
+        case InstructionType::INST_OR: this->_logic<InstructionType::INST_OR>(); break;
+        case InstructionType::INST_XOR: this->_logic<InstructionType::INST_XOR>(); break;
+    }
+}
+
+// compares two values, and returns the result
+template <InstructionType OP, bool CHECKED>
+bool Interpreter::_compare_values(const Value& left_val, const Value& right_val){
+    try{
+        return compare_values<OP, CHECKED>(left_val, right_val);
+    }
+    catch (const std::runtime_error& e){
+        throw std::runtime_error(std::format("Error on line {}: {}", this->_current_line(), e.what()));
+    }
+}
+
+// runs a single comparison operation
+template <InstructionType OP, bool CHECKED>
+void Interpreter::_compare(){
+    if (CHECKED && this->_stack.size() < 2)
+        throw std::runtime_error(std::format("Error on line {}: comparison operations require at least two values on the stack", this->_current_line()));
+    Value& left_val = this->_stack[this->_stack.size() - 2];
+    bool result = this->_compare_values<OP, CHECKED>(left_val, this->_stack.back());
+    left_val = Value(ValueType::TYPE_BOOL, result);
+    this->_stack.pop_back();
 }
 
 // runs a coparison operation
 void Interpreter::_comp_op(const Instruction& inst){
-    if (this->_stack.size() < 2)
-        throw std::runtime_error(std::format("Error on line {}: comparison operations require at least two values on the stack", this->_line_no));
-    Value right_val = this->stack_pop();
-    Value left_val = this->stack_pop();
-    int comparison_offset {19};
-    bool result;
     switch (inst.op_code){
-        case InstructionType::INST_NEQ:
-        case InstructionType::INST_EQ:
-            // this is some black magic
-            result = (left_val == right_val) == static_cast<bool>(static_cast<int>(inst.op_code) - 17);
-            this->stack_push(Value(ValueType::TYPE_BOOL, result));
-            return;
-        case InstructionType::INST_LESS:
-        case InstructionType::INST_GREATER:
-        case InstructionType::INST_LESS_EQ:
-        case InstructionType::INST_GREATER_EQ:
-            if (!left_val.is_intergral() || !right_val.is_intergral())
-                throw std::runtime_error(std::format("Error on line {}: comparison operations cannot be performed on non-integral types", this->_line_no));
-            // check if this is a "or equal operation"
-            if (inst.op_code > InstructionType::INST_GREATER){
-                if (left_val == right_val){
-                    this->stack_push(Value(ValueType::TYPE_BOOL, true));
-                    return;
-                }
-                comparison_offset += 2;  
-            }
-            // similar black magic to above
-            result = (left_val > right_val) == static_cast<bool>(static_cast<int>(inst.op_code) - comparison_offset);
-            this->stack_push(Value(ValueType::TYPE_BOOL, result));
-            break;
+        case InstructionType::INST_NEQ: this->_compare<InstructionType::INST_NEQ>(); break;
+        case InstructionType::INST_EQ: this->_compare<InstructionType::INST_EQ>(); break;
+        case InstructionType::INST_LESS: this->_compare<InstructionType::INST_LESS>(); break;
+        case InstructionType::INST_GREATER: this->_compare<InstructionType::INST_GREATER>(); break;
+        case InstructionType::INST_LESS_EQ: this->_compare<InstructionType::INST_LESS_EQ>(); break;
+        case InstructionType::INST_GREATER_EQ: this->_compare<InstructionType::INST_GREATER_EQ>(); break;
     }
 }
 
 // runs a logical not operation 
+template <bool CHECKED>
 void Interpreter::_not_op(const Instruction& inst){
     // ensure there is at least one item on the stack
-    if (this->_stack.size() < 1)
-        throw std::runtime_error(std::format("Error on line {}: No stack data for not operation", this->_line_no));
-    Value val = this->stack_pop();
-    if (!val.is_intergral())
-        throw std::runtime_error(std::format("Error on line {}: invalid type for NOT operation", this->_line_no));
-    int data = val.as_int();
-    bool result = (data != 0);
-    this->stack_push(Value(ValueType::TYPE_BOOL, result));
+    if (CHECKED && this->_stack.size() < 1)
+        throw std::runtime_error(std::format("Error on line {}: No stack data for not operation", this->_current_line()));
+    Value& val = this->_stack.back();
+    try{
+        val = Value(ValueType::TYPE_BOOL, CHECKED ? not_value(val) : val.get_int() != 0);
+    }
+    catch (const std::runtime_error& e){
+        throw std::runtime_error(std::format("Error on line {}: {}", this->_current_line(), e.what()));
+    }
+}
+
+// pops the condition for a jif instruction, and jumps if it's true
+template <bool CHECKED>
+void Interpreter::_jumpif_op(const Instruction& inst){
+    if (CHECKED && this->_stack.empty())
+        throw std::runtime_error(std::format("Error on line {}: no value to evaluate for jif instruction", this->_current_line()));
+    bool condition = CHECKED ? this->_stack.back().as_int() : this->_stack.back().get_int();
+    this->_stack.pop_back();
+    if (condition)
+        this->_next_op = inst.arg.value().get_int() - 1;
 }
 
 // runs a jump operation
 void Interpreter::_jump_op(const Instruction& inst){
-    Value condition_val;
-    int addr;
     switch (inst.op_code){
         case InstructionType::INST_JUMP:
         case InstructionType::INST_CALL:
             if (inst.op_code == InstructionType::INST_CALL)
                 this->_push_return(this->_next_op);
-            this->_next_op = std::get<int>(inst.arg.value().get_value()) - 1;
+            this->_next_op = inst.arg.value().get_int() - 1;
             break;
         case InstructionType::INST_RET:
             // no validation is needed, as the return address can only be set by the above case, if no address is set, this will restart the program
             this->_next_op = _pop_return();
             break;
         case InstructionType::INST_JUMPIF:
-            if (this->_stack.empty())
-                throw std::runtime_error(std::format("Error on line {}: no value to evaluate for jif instruction", this->_line_no));
-            condition_val = this->stack_pop();
-            if (condition_val.as_int())
-                this->_next_op = std::get<int>(inst.arg.value().get_value()) - 1;
+            this->_jumpif_op(inst);
             break;
     }
 }
 
+// pops the top value of the stack into a variable's slot
+template <bool CHECKED>
+void Interpreter::_set_op(const Instruction& inst){
+    if (CHECKED && this->_stack.empty())
+        throw std::runtime_error(std::format("Error on line {}: Not enough stack data to assign variable", this->_current_line()));
+    this->_vars[inst.arg.value().get_int()] = std::move(this->_stack.back());
+    this->_stack.pop_back();
+}
+
+// pushes the value in a variable's slot to the stack, slots that have never been set hold a null value
+void Interpreter::_get_op(const Instruction& inst){
+    int slot = inst.arg.value().get_int();
+    const Value& val = this->_vars[slot];
+    if (val.get_type() == ValueType::TYPE_NULL)
+        throw std::runtime_error(std::format("Error on line {}: Variable \"{}\" is undeclared", this->_current_line(), this->_parser.var_names()[slot]));
+    this->stack_push(val);
+}
+
 // runs set and get operations
 void Interpreter::_var_op(const Instruction& inst){
-    Value val;
-    std::string var_name;
     switch (inst.op_code){
         case InstructionType::INST_SET:
-            if (this->_stack.empty())
-                throw std::runtime_error(std::format("Error on line {}: Not enough stack data to assign variable", this->_line_no));
-            val = this->stack_pop();
-            this->_vars[std::get<std::string>(inst.arg.value().get_value())] = val;
+            this->_set_op(inst);
             break;
         case InstructionType::INST_GET:
-            var_name = std::get<std::string>(inst.arg.value().get_value());
-            if (!this->_vars.count(var_name))
-                throw std::runtime_error(std::format("Error on line {}: Variable \"{}\" is undeclared", this->_line_no, var_name));
-            val = this->_vars.at(var_name);
-            this->stack_push(val);
+            this->_get_op(inst);
             break;
     }
 }
 
+// prints the top value of the stack, without popping it
+template <bool CHECKED>
+void Interpreter::_print_op(bool newline){
+    if (CHECKED && this->_stack.empty())
+        throw std::runtime_error(std::format("Error on line {}: Not enough stack data to print", this->_current_line()));
+    this->_print_value(this->_stack.back(), newline);
+}
+
+void Interpreter::_print_value(const Value& val, bool newline){
+    this->_output.write_value(val);
+    if (newline)
+        this->_output.new_line();
+}
+
+// reads a line of input, writing any output first so a prompt is shown before the program waits
+std::string Interpreter::_read_line(){
+    this->_output.flush();
+    std::string str_in;
+    std::getline(std::cin, str_in);
+    return str_in;
+}
+
+// reads a line of input as a string
+void Interpreter::_read_op(){
+    this->stack_push(Value(ValueType::TYPE_STR, this->_read_line()));
+}
+
+// reads a line of input as an integer, and pushes it
+void Interpreter::_readint_op(){
+    this->stack_push(this->_read_int());
+}
+
+// reads a line of input, and parses it as an integer
+Value Interpreter::_read_int(){
+    std::string str_in = this->_read_line();
+    try{
+        return Value(ValueType::TYPE_INT, std::stoi(str_in));
+    }
+    catch (const std::invalid_argument & e) {
+        throw std::runtime_error(std::format("Error on line {}: Non-integer input recived for readint", this->_current_line()));
+    }
+    catch (const std::out_of_range & e) {
+        throw std::runtime_error(std::format("Error on line {}: Out-of-range input recived for readint", this->_current_line()));
+    }
+}
+
 // runs an I/O operations
 void Interpreter::_io_op(const Instruction& inst){
-    Value val;
-    std::string str_in;
-    int num_in;
     switch (inst.op_code){
         case InstructionType::INST_PRINT:
-            if (this->_stack.empty())
-                throw std::runtime_error(std::format("Error on line {}: Not enough stack data to print", this->_line_no));
-            val = this->stack_top();
-            std::cout << val.to_string();
+            this->_print_op(false);
             break;
         case InstructionType::INST_PRINTLN:
-            if (this->_stack.empty())
-                throw std::runtime_error(std::format("Error on line {}: Not enough stack data to print", this->_line_no));
-            val = this->stack_top();
-            std::cout << val.to_string() << std::endl;
+            this->_print_op(true);
             break;
         case InstructionType::INST_READ:
-            std::getline(std::cin, str_in);
-            this->stack_push(Value(ValueType::TYPE_STR, str_in));
+            this->_read_op();
             break;
         case InstructionType::INST_READINT:
-            std::getline(std::cin, str_in);
-            try{
-                num_in = std::stoi(str_in);
-                this->stack_push(Value(ValueType::TYPE_INT, num_in));
-            }
-            catch (const std::invalid_argument & e) {
-                throw std::runtime_error(std::format("Error on line {}: Non-integer input recived for readint", this->_line_no));
-            }
-            catch (const std::out_of_range & e) {
-                throw std::runtime_error(std::format("Error on line {}: Out-of-range input recived for readint", this->_line_no));
-            }
+            this->_readint_op();
+            break;
+        case InstructionType::INST_FLUSH:
+            this->_output.flush();
             break;
     }
 }
 
+// pushes the character found at a given index of a collection
+template <bool CHECKED>
+void Interpreter::_at_op(){
+    if (CHECKED && this->_stack.size() < 2)
+        throw std::runtime_error(std::format("Error on line {}: The \"at\" instruction expects at least two values on the stack.", this->_current_line()));
+    // the character overwrites the index in place, and the collection is popped
+    Value& collection = this->_stack.back();
+    Value& index = this->_stack[this->_stack.size() - 2];
+    if (CHECKED && index.get_type() != ValueType::TYPE_INT)
+        throw std::runtime_error(std::format("Error on line {}: Index values must be of integer type", this->_current_line()));
+    try{
+        index = collection.get_index(index.as_int());
+        this->_stack.pop_back();
+    }
+    catch (std::out_of_range e){
+        throw std::runtime_error(std::format("Range Error on line {}: Index out of range.", this->_current_line()));
+    }
+    catch (std::runtime_error e){
+        throw std::runtime_error(std::format("Error on line {}: {}", this->_current_line(), e.what()));
+    }
+}
+
+// pushes the length of a collection
+template <bool CHECKED>
+void Interpreter::_len_op(){
+    if (CHECKED && this->_stack.size() < 1)
+        throw std::runtime_error(std::format("Error on line {}: The \"len\" instruction expects at least one value on the stack.", this->_current_line()));
+    Value& collection = this->_stack.back();
+    try{
+        int length = CHECKED ? collection.get_len() : collection.get_str().length();
+        collection = Value(ValueType::TYPE_INT, length);
+    }
+    catch (std::runtime_error e){
+        throw std::runtime_error(std::format("Error on line {}: {}", this->_current_line(), e.what()));
+    }
+}
+
 // runs an array/collection operation
 void Interpreter::_arr_op(const Instruction& inst){
-    Value collection, index, result;
-    int length;
     switch (inst.op_code){
         case InstructionType::INST_AT:
-            if (this->_stack.size() < 2)
-                throw std::runtime_error(std::format("Error on line {}: The \"at\" instruction expects at least two values on the stack.", this->_line_no));
-            collection = this->stack_pop();
-            index = this->stack_pop();
-            if (index.get_type() != ValueType::TYPE_INT)
-                throw std::runtime_error(std::format("Error on line {}: Index values must be of integer type", this->_line_no));
-            try{
-                result = collection.get_index(index.as_int());
-                this->stack_push(result);
-            }
-            catch (std::out_of_range e){
-                throw std::runtime_error(std::format("Range Error on line {}: Index out of range.", this->_line_no));
-            }
-            catch (std::runtime_error e){
-                throw std::runtime_error(std::format("Error on line {}: {}", this->_line_no, e.what()));
-            }
+            this->_at_op();
             break;
         case InstructionType::INST_LEN:
-            if (this->_stack.size() < 1)
-                throw std::runtime_error(std::format("Error on line {}: The \"len\" instruction expects at least one value on the stack.", this->_line_no));
-            collection = this->stack_pop();
-            try{
-                length = collection.get_len();
-                result = Value(ValueType::TYPE_INT, length);
-                this->stack_push(result);
-            }
-            catch (std::runtime_error e){
-                throw std::runtime_error(std::format("Error on line {}: {}", this->_line_no, e.what()));
-            }
+            this->_len_op();
             break;
     }
 }
 
+// replaces the top value of the stack with its type
+void Interpreter::_valtype_op(){
+    if (this->_stack.empty())
+        throw std::runtime_error(std::format("Error on line {}: insufficient stack data for 'type' command", this->_current_line()));
+    Value& val = this->_stack.back();
+    val = Value(ValueType::TYPE_VALTYPE, static_cast<int>(val.get_type()));
+}
+
+// converts the second to top value of the stack to the type on top of the stack
+void Interpreter::_convert_op(){
+    if (this->_stack.size() < 2)
+        throw std::runtime_error(std::format("Type Error on line {}: insufficient stack data for 'conv' command", this->_current_line()));
+    // the converted value overwrites the original in place, and the type is popped
+    const Value& type = this->_stack.back();
+    Value& val = this->_stack[this->_stack.size() - 2];
+    if (type.get_type() != ValueType::TYPE_VALTYPE)
+        throw std::runtime_error(std::format("Type Error on line {}: Invalid type for conversion", this->_current_line()));
+    try{
+        val = convert_value(val, static_cast<ValueType>(type.get_int()));
+    }
+    catch (std::runtime_error e){
+        throw std::runtime_error(std::format("Error on line {}: {}", this->_current_line(), e.what()));
+    }
+    catch (const std::invalid_argument & e) {
+        throw std::runtime_error(std::format("Value Error on line {}: Non-integer input recived for readint", this->_current_line()));
+    }
+    catch (const std::out_of_range & e) {
+        throw std::runtime_error(std::format("Value Error on line {}: Out-of-range input recived for readint", this->_current_line()));
+    }
+    this->_stack.pop_back();
+}
+
 // runs a type or conversion operation
 void Interpreter::_type_op(const Instruction& inst){
-    int int_val;
-    Value val, type, result;
     switch (inst.op_code){
         case InstructionType::INST_TYPE:
-            if (this->_stack.empty())
-                throw std::runtime_error(std::format("Error on line {}: insufficient stack data for 'type' command", this->_line_no));
-            val = this->stack_pop();
-            result = Value(ValueType::TYPE_VALTYPE, static_cast<int>(val.get_type()));
+            this->_valtype_op();
             break;
         case InstructionType::INST_CONVERT:
-            if (this->_stack.size() < 2)
-                throw std::runtime_error(std::format("Type Error on line {}: insufficient stack data for 'conv' command", this->_line_no));
-            type = this->stack_pop();
-            val = this->stack_pop();
-            if (type.get_type() != ValueType::TYPE_VALTYPE)
-                throw std::runtime_error(std::format("Type Error on line {}: Invalid type for conversion", this->_line_no));
-            try{
-                switch (static_cast<ValueType>(std::get<int>(type.get_value()))){
-                    case ValueType::TYPE_INT:
-                        // strings are non-integral values, and must be handled seprately
-                        if (val.get_type() == ValueType::TYPE_STR){
-                            int_val = std::stoi(std::get<std::string>(val.get_value()));
-                            result = Value(ValueType::TYPE_INT, int_val);
-                        }
-                        else
-                            result = Value(ValueType::TYPE_INT, val.as_int());
-                        break;
-                    case ValueType::TYPE_FLOAT:
-                        if (val.get_type() != ValueType::TYPE_INT)
-                            throw std::runtime_error(std::format("Type Error on line {}: Can only convert integer values to float", this->_line_no));
-                        result = Value::from_int(ValueType::TYPE_FLOAT, std::get<int>(val.get_value()));
-                        break;
-                    case ValueType::TYPE_CHAR:
-                        result = Value(ValueType::TYPE_CHAR, val.as_char());
-                        break;
-                    case ValueType::TYPE_BOOL:
-                        result = Value(ValueType::TYPE_BOOL, val.as_bool());
-                        break;
-                    case ValueType::TYPE_STR:
-                        result = Value(ValueType::TYPE_STR, val.to_string());
-                        break;
-                }
-            }
-            catch (std::runtime_error e){
-                throw std::runtime_error(std::format("Error on line {}: {}", this->_line_no, e.what()));
-            }
-            catch (const std::invalid_argument & e) {
-                throw std::runtime_error(std::format("Value Error on line {}: Non-integer input recived for readint", this->_line_no));
-            }
-            catch (const std::out_of_range & e) {
-                throw std::runtime_error(std::format("Value Error on line {}: Out-of-range input recived for readint", this->_line_no));
-            }
+            this->_convert_op();
             break;
     }
-    this->stack_push(result);
 }
 
 // runs a conditional expression
+template <bool CHECKED>
 void Interpreter::_cond_op(){
-    if (this->_stack.size() < 3)
-        throw std::runtime_error(std::format("Stack Error on line {}: Conditional expressions require at least 3 values on the stack", this->_line_no));
-    Value true_val = this->stack_pop();
-    Value false_val = this->stack_pop();
-    Value cond_val = this->stack_pop();
-    this->stack_push(cond_val.as_bool() ? true_val : false_val);
+    if (CHECKED && this->_stack.size() < 3)
+        throw std::runtime_error(std::format("Stack Error on line {}: Conditional expressions require at least 3 values on the stack", this->_current_line()));
+    // the chosen value overwrites the condition in place, and both options are popped
+    size_t size = this->_stack.size();
+    Value& cond_val = this->_stack[size - 3];
+    bool cond = CHECKED ? cond_val.as_bool() : cond_val.get_int() != 0;
+    cond_val = std::move(cond ? this->_stack[size - 1] : this->_stack[size - 2]);
+    this->_stack.resize(size - 2);
+}
+
+// SUPERINSTRUCTIONS FOLLOW
+// compares the top two values of the stack, pops them, and jumps if the comparison is true
+template <InstructionType OP, bool CHECKED>
+void Interpreter::_compare_jump(const Instruction& inst){
+    if (CHECKED && this->_stack.size() < 2)
+        throw std::runtime_error(std::format("Error on line {}: comparison operations require at least two values on the stack", this->_current_line()));
+    size_t size = this->_stack.size();
+    bool result = this->_compare_values<OP, CHECKED>(this->_stack[size - 2], this->_stack[size - 1]);
+    this->_stack.resize(size - 2);
+    if (result)
+        this->_next_op = inst.arg.value().get_int() - 1;
+}
+
+// adds an immediate value to the top of the stack
+template <bool CHECKED>
+void Interpreter::_add_imm_op(const Instruction& inst){
+    if (CHECKED && this->_stack.empty())
+        throw std::runtime_error(std::format("Error on line {}: arithmetic operations require at least two values on the stack", this->_current_line()));
+    this->_arith_values<InstructionType::INST_ADD, CHECKED>(this->_stack.back(), inst.arg.value());
+}
+
+// adds an immediate value to a variable in place, the variable's slot is stored in the instruction's aux field
+template <bool CHECKED>
+void Interpreter::_inc_var_op(const Instruction& inst){
+    Value& var = this->_vars[inst.aux];
+    if (var.get_type() == ValueType::TYPE_NULL)
+        throw std::runtime_error(std::format("Error on line {}: Variable \"{}\" is undeclared", this->_current_line(), this->_parser.var_names()[inst.aux]));
+    this->_arith_values<InstructionType::INST_ADD, CHECKED>(var, inst.arg.value());
+}
+
+// runs a fused compare and branch instruction
+void Interpreter::_compare_jump_op(const Instruction& inst){
+    switch (inst.op_code){
+        case InstructionType::INST_JUMP_NEQ: this->_compare_jump<InstructionType::INST_NEQ>(inst); break;
+        case InstructionType::INST_JUMP_EQ: this->_compare_jump<InstructionType::INST_EQ>(inst); break;
+        case InstructionType::INST_JUMP_LESS: this->_compare_jump<InstructionType::INST_LESS>(inst); break;
+        case InstructionType::INST_JUMP_GREATER: this->_compare_jump<InstructionType::INST_GREATER>(inst); break;
+        case InstructionType::INST_JUMP_LESS_EQ: this->_compare_jump<InstructionType::INST_LESS_EQ>(inst); break;
+        case InstructionType::INST_JUMP_GREATER_EQ: this->_compare_jump<InstructionType::INST_GREATER_EQ>(inst); break;
+    }
+}
+
+// QUICKENED INSTRUCTIONS FOLLOW
+// rewrites an instruction in place to a version specialized for the types of its operands, if there is one
+void Interpreter::_quicken(Instruction& inst){
+    size_t size = this->_stack.size();
+    if (inst.generic || size < 2)
+        return;
+    inst.op_code = quickened_op(inst.op_code, this->_stack[size - 2].get_type(), this->_stack[size - 1].get_type());
+}
+
+// reverts a quickened instruction to its generic op code, and stops it from being quickened again
+void Interpreter::_despecialize(Instruction& inst){
+    inst.op_code = generic_op(inst.op_code);
+    inst.generic = true;
+}
+
+// runs an arithmetic operation specialized for operands of the given type
+template <InstructionType OP, ValueType TYPE>
+bool Interpreter::_arith_typed(){
+    size_t size = this->_stack.size();
+    if (size < 2 || this->_stack[size - 2].get_type() != TYPE || this->_stack[size - 1].get_type() != TYPE)
+        return false;
+    this->_arith_values<OP, false>(this->_stack[size - 2], this->_stack[size - 1]);
+    this->_stack.pop_back();
+    return true;
+}
+
+// runs a comparison specialized for integral operands of the given type
+template <InstructionType OP, ValueType TYPE>
+bool Interpreter::_compare_typed(){
+    size_t size = this->_stack.size();
+    if (size < 2 || this->_stack[size - 2].get_type() != TYPE || this->_stack[size - 1].get_type() != TYPE)
+        return false;
+    Value& left_val = this->_stack[size - 2];
+    left_val = Value(ValueType::TYPE_BOOL, compare_ints<OP>(left_val.get_int(), this->_stack[size - 1].get_int()));
+    this->_stack.pop_back();
+    return true;
+}
+
+// runs a fused compare and branch specialized for int operands
+template <InstructionType OP>
+bool Interpreter::_compare_jump_int(const Instruction& inst){
+    size_t size = this->_stack.size();
+    if (size < 2 || this->_stack[size - 2].get_type() != ValueType::TYPE_INT || this->_stack[size - 1].get_type() != ValueType::TYPE_INT)
+        return false;
+    bool result = compare_ints<OP>(this->_stack[size - 2].get_int(), this->_stack[size - 1].get_int());
+    this->_stack.resize(size - 2);
+    if (result)
+        this->_next_op = inst.arg.value().get_int() - 1;
+    return true;
 }
 
 // INTERPRETER FUNCTIONS FOLLOW
-// runs a list of instrunctions produced by the parser
+// runs a list of instrunctions produced by the parser, counting each instruction run if STATS is set, and timing each one if PROFILE is set
+template <bool STATS, bool PROFILE>
 void Interpreter::_run_bytecode(){
     Instruction inst;
+    [[maybe_unused]] size_t index;
+    [[maybe_unused]] uint64_t start;
     while (this->_next_op < this->_instructions.size()){
+        if constexpr (STATS)
+            this->_count_op();
+        if constexpr (PROFILE){
+            index = this->_next_op;
+            start = profile_clock();
+        }
         inst = this->_instructions[this->_next_op];
         switch (inst.op_code){
             case InstructionType::INST_POP:
@@ -473,6 +646,7 @@ void Interpreter::_run_bytecode(){
             case InstructionType::INST_PRINTLN:
             case InstructionType::INST_READ:
             case InstructionType::INST_READINT:
+            case InstructionType::INST_FLUSH:
                 this->_io_op(inst);
                 break;
             case InstructionType::INST_AT:
@@ -486,31 +660,1092 @@ void Interpreter::_run_bytecode(){
             case InstructionType::INST_COND:
                 this->_cond_op();
                 break;
+            case InstructionType::INST_JUMP_NEQ:
+            case InstructionType::INST_JUMP_EQ:
+            case InstructionType::INST_JUMP_LESS:
+            case InstructionType::INST_JUMP_GREATER:
+            case InstructionType::INST_JUMP_LESS_EQ:
+            case InstructionType::INST_JUMP_GREATER_EQ:
+                this->_compare_jump_op(inst);
+                break;
+            case InstructionType::INST_INC_VAR:
+                this->_inc_var_op(inst);
+                break;
+            case InstructionType::INST_ADD_IMM:
+                this->_add_imm_op(inst);
+                break;
+            case InstructionType::INST_PRINT_POP:
+            case InstructionType::INST_PRINTLN_POP:
+                this->_print_op(inst.op_code == InstructionType::INST_PRINTLN_POP);
+                this->_stack.pop_back();
+                break;
         }
         this->_next_op++;
+        if constexpr (PROFILE){
+            this->_profiler.record(index, profile_clock() - start);
+            // a call isn't a loop, even when it calls code above it
+            if (this->_next_op <= index && is_jump(inst.op_code) && inst.op_code != InstructionType::INST_CALL)
+                this->_profiler.record_back_jump(index);
+        }
+    }
+}
+
+/*
+    the threaded engine uses computed gotos (a GCC/Clang extension) when they're available, so each handler jumps
+    directly to the next op code's handler, falling back to a portable switch otherwise. In both cases, every op code
+    has its own handler, and instructions are read in place rather than copied.
+    the first time a generic arithmetic or comparison instruction runs, it's quickened: rewritten in place to an op code
+    specialized for its operand types. if a quickened instruction later sees other types, it's reverted to the generic
+    op code for good and dispatched again.
+    with computed gotos, instructions marked by the verifier are dispatched to a second set of handlers that skip the
+    stack depth and type checks, the portable switch always runs the checked handlers
+*/
+#if (defined(__GNUC__) || defined(__clang__)) && !defined(EVO_NO_COMPUTED_GOTO)
+    #define EVO_COMPUTED_GOTO
+#endif
+
+// counts and traces the instruction about to run, which costs nothing when neither is on
+#define INSTRUMENT_OP() \
+    do { \
+        if constexpr (STATS) \
+            this->_count_op(); \
+        if constexpr (TRACE) \
+            this->_trace_op(*inst); \
+    } while (0)
+
+#ifdef EVO_COMPUTED_GOTO
+    #define TARGET(op) op_##op:
+    #define FAST_TARGET(op) fast_##op:
+    #define DISPATCH_INDEX(inst) (static_cast<size_t>((inst)->op_code) + (inst)->verified * INST_TYPE_COUNT)
+    #define DISPATCH() \
+        do { \
+            if (++this->_next_op >= inst_count) \
+                return; \
+            inst = &code[this->_next_op]; \
+            INSTRUMENT_OP(); \
+            goto *dispatch_table[DISPATCH_INDEX(inst)]; \
+        } while (0)
+    #define DESPECIALIZE() \
+        { \
+            this->_despecialize(*inst); \
+            goto *dispatch_table[DISPATCH_INDEX(inst)]; \
+        }
+#else
+    #define TARGET(op) case InstructionType::op:
+    #define DISPATCH() break
+    // the loop increments the next op, so stepping it back runs the same instruction again
+    #define DESPECIALIZE() \
+        { \
+            this->_despecialize(*inst); \
+            this->_next_op--; \
+            break; \
+        }
+#endif
+
+// runs the loaded instructions with direct threaded dispatch, counting each one if STATS is set and recording it in the trace if TRACE is set
+template <bool STATS, bool TRACE>
+void Interpreter::_run_threaded(){
+    Instruction* code = this->_instructions.data();
+    const size_t inst_count = this->_instructions.size();
+    if (this->_next_op >= inst_count)
+        return;
+    Instruction* inst = &code[this->_next_op];
+#ifdef EVO_COMPUTED_GOTO
+    constexpr size_t INST_TYPE_COUNT {static_cast<size_t>(InstructionType::INST_COUNT)};
+    // quickened handlers check their operands' types themselves, so they're the same in both halves of the table
+    #define QUICKENED_TARGETS \
+        &&op_INST_ADD_INT, &&op_INST_SUB_INT, &&op_INST_MUL_INT, &&op_INST_DIV_INT, &&op_INST_MOD_INT, &&op_INST_ADD_FLOAT, \
+        &&op_INST_SUB_FLOAT, &&op_INST_MUL_FLOAT, &&op_INST_DIV_FLOAT, &&op_INST_NEQ_INT, &&op_INST_EQ_INT, &&op_INST_LESS_INT, \
+        &&op_INST_GREATER_INT, &&op_INST_LESS_EQ_INT, &&op_INST_GREATER_EQ_INT, &&op_INST_NEQ_CHAR, &&op_INST_EQ_CHAR, \
+        &&op_INST_JUMP_NEQ_INT, &&op_INST_JUMP_EQ_INT, &&op_INST_JUMP_LESS_INT, &&op_INST_JUMP_GREATER_INT, \
+        &&op_INST_JUMP_LESS_EQ_INT, &&op_INST_JUMP_GREATER_EQ_INT
+    /*
+        one entry per op code, in the same order as the InstructionType enum, for the checked handlers followed by
+        the unchecked handlers. op codes without any checks to skip use their checked handler in both halves
+    */
+    static void* dispatch_table[] = {
+        &&op_INST_NULL, &&op_INST_PUSH, &&op_INST_POP, &&op_INST_CLEAR, &&op_INST_PEEK, &&op_INST_SWAP, &&op_INST_SIZE,
+        &&op_INST_DUP, &&op_INST_ADD, &&op_INST_SUB, &&op_INST_MUL, &&op_INST_DIV, &&op_INST_MOD, &&op_INST_AND,
+        &&op_INST_OR, &&op_INST_XOR, &&op_INST_NOT, &&op_INST_NEQ, &&op_INST_EQ, &&op_INST_LESS, &&op_INST_GREATER,
+        &&op_INST_LESS_EQ, &&op_INST_GREATER_EQ, &&op_INST_JUMP, &&op_INST_JUMPIF, &&op_INST_CALL, &&op_INST_RET,
+        &&op_INST_GET, &&op_INST_SET, &&op_INST_PRINT, &&op_INST_PRINTLN, &&op_INST_READ, &&op_INST_READINT,
+        &&op_INST_FLUSH, &&op_INST_AT, &&op_INST_LEN, &&op_INST_TYPE, &&op_INST_CONVERT, &&op_INST_COND, &&op_INST_JUMP_NEQ,
+        &&op_INST_JUMP_EQ, &&op_INST_JUMP_LESS, &&op_INST_JUMP_GREATER, &&op_INST_JUMP_LESS_EQ, &&op_INST_JUMP_GREATER_EQ,
+        &&op_INST_INC_VAR, &&op_INST_ADD_IMM, &&op_INST_PRINT_POP, &&op_INST_PRINTLN_POP, QUICKENED_TARGETS,
+        // unchecked handlers
+        &&op_INST_NULL, &&op_INST_PUSH, &&fast_INST_POP, &&op_INST_CLEAR, &&op_INST_PEEK, &&fast_INST_SWAP, &&op_INST_SIZE,
+        &&fast_INST_DUP, &&fast_INST_ADD, &&fast_INST_SUB, &&fast_INST_MUL, &&fast_INST_DIV, &&fast_INST_MOD, &&fast_INST_AND,
+        &&fast_INST_OR, &&fast_INST_XOR, &&fast_INST_NOT, &&fast_INST_NEQ, &&fast_INST_EQ, &&fast_INST_LESS, &&fast_INST_GREATER,
+        &&fast_INST_LESS_EQ, &&fast_INST_GREATER_EQ, &&op_INST_JUMP, &&fast_INST_JUMPIF, &&op_INST_CALL, &&op_INST_RET,
+        &&op_INST_GET, &&fast_INST_SET, &&fast_INST_PRINT, &&fast_INST_PRINTLN, &&op_INST_READ, &&op_INST_READINT,
+        &&op_INST_FLUSH, &&fast_INST_AT, &&fast_INST_LEN, &&op_INST_TYPE, &&op_INST_CONVERT, &&fast_INST_COND, &&fast_INST_JUMP_NEQ,
+        &&fast_INST_JUMP_EQ, &&fast_INST_JUMP_LESS, &&fast_INST_JUMP_GREATER, &&fast_INST_JUMP_LESS_EQ, &&fast_INST_JUMP_GREATER_EQ,
+        &&fast_INST_INC_VAR, &&fast_INST_ADD_IMM, &&fast_INST_PRINT_POP, &&fast_INST_PRINTLN_POP, QUICKENED_TARGETS
+    };
+    static_assert(sizeof(dispatch_table) / sizeof(void*) == 2 * INST_TYPE_COUNT, "dispatch table is out of sync with InstructionType");
+    #undef QUICKENED_TARGETS
+    INSTRUMENT_OP();
+    goto *dispatch_table[DISPATCH_INDEX(inst)];
+#else
+    for (; this->_next_op < inst_count; this->_next_op++){
+        inst = &code[this->_next_op];
+        INSTRUMENT_OP();
+        switch (inst->op_code){
+#endif
+    TARGET(INST_NULL)
+        DISPATCH();
+    TARGET(INST_PUSH)
+        this->_push_op(*inst);
+        DISPATCH();
+    TARGET(INST_POP)
+        this->_pop_op();
+        DISPATCH();
+    TARGET(INST_CLEAR)
+        this->_stack.clear();
+        DISPATCH();
+    TARGET(INST_PEEK)
+        this->_peek_op();
+        DISPATCH();
+    TARGET(INST_SWAP)
+        this->_swap_op();
+        DISPATCH();
+    TARGET(INST_SIZE)
+        this->stack_push(Value(ValueType::TYPE_INT, static_cast<int>(this->_stack.size())));
+        DISPATCH();
+    TARGET(INST_DUP)
+        this->stack_dup();
+        DISPATCH();
+    TARGET(INST_ADD)
+        this->_quicken(*inst);
+        this->_arith<InstructionType::INST_ADD>();
+        DISPATCH();
+    TARGET(INST_SUB)
+        this->_quicken(*inst);
+        this->_arith<InstructionType::INST_SUB>();
+        DISPATCH();
+    TARGET(INST_MUL)
+        this->_quicken(*inst);
+        this->_arith<InstructionType::INST_MUL>();
+        DISPATCH();
+    TARGET(INST_DIV)
+        this->_quicken(*inst);
+        this->_arith<InstructionType::INST_DIV>();
+        DISPATCH();
+    TARGET(INST_MOD)
+        this->_quicken(*inst);
+        this->_arith<InstructionType::INST_MOD>();
+        DISPATCH();
+    TARGET(INST_AND)
+        this->_logic<InstructionType::INST_AND>();
+        DISPATCH();
+    TARGET(INST_OR)
+        this->_logic<InstructionType::INST_OR>();
+        DISPATCH();
+    TARGET(INST_XOR)
+        this->_logic<InstructionType::INST_XOR>();
+        DISPATCH();
+    TARGET(INST_NOT)
+        this->_not_op(*inst);
+        DISPATCH();
+    TARGET(INST_NEQ)
+        this->_quicken(*inst);
+        this->_compare<InstructionType::INST_NEQ>();
+        DISPATCH();
+    TARGET(INST_EQ)
+        this->_quicken(*inst);
+        this->_compare<InstructionType::INST_EQ>();
+        DISPATCH();
+    TARGET(INST_LESS)
+        this->_quicken(*inst);
+        this->_compare<InstructionType::INST_LESS>();
+        DISPATCH();
+    TARGET(INST_GREATER)
+        this->_quicken(*inst);
+        this->_compare<InstructionType::INST_GREATER>();
+        DISPATCH();
+    TARGET(INST_LESS_EQ)
+        this->_quicken(*inst);
+        this->_compare<InstructionType::INST_LESS_EQ>();
+        DISPATCH();
+    TARGET(INST_GREATER_EQ)
+        this->_quicken(*inst);
+        this->_compare<InstructionType::INST_GREATER_EQ>();
+        DISPATCH();
+    TARGET(INST_CALL)
+        this->_push_return(this->_next_op);
+        // fall through to the jump handler
+    TARGET(INST_JUMP)
+        this->_next_op = inst->arg.value().get_int() - 1;
+        DISPATCH();
+    TARGET(INST_JUMPIF)
+        this->_jumpif_op(*inst);
+        DISPATCH();
+    TARGET(INST_RET)
+        this->_next_op = this->_pop_return();
+        DISPATCH();
+    TARGET(INST_GET)
+        this->_get_op(*inst);
+        DISPATCH();
+    TARGET(INST_SET)
+        this->_set_op(*inst);
+        DISPATCH();
+    TARGET(INST_PRINT)
+        this->_print_op(false);
+        DISPATCH();
+    TARGET(INST_PRINTLN)
+        this->_print_op(true);
+        DISPATCH();
+    TARGET(INST_READ)
+        this->_read_op();
+        DISPATCH();
+    TARGET(INST_READINT)
+        this->_readint_op();
+        DISPATCH();
+    TARGET(INST_FLUSH)
+        this->_output.flush();
+        DISPATCH();
+    TARGET(INST_AT)
+        this->_at_op();
+        DISPATCH();
+    TARGET(INST_LEN)
+        this->_len_op();
+        DISPATCH();
+    TARGET(INST_TYPE)
+        this->_valtype_op();
+        DISPATCH();
+    TARGET(INST_CONVERT)
+        this->_convert_op();
+        DISPATCH();
+    TARGET(INST_COND)
+        this->_cond_op();
+        DISPATCH();
+    TARGET(INST_JUMP_NEQ)
+        this->_quicken(*inst);
+        this->_compare_jump<InstructionType::INST_NEQ>(*inst);
+        DISPATCH();
+    TARGET(INST_JUMP_EQ)
+        this->_quicken(*inst);
+        this->_compare_jump<InstructionType::INST_EQ>(*inst);
+        DISPATCH();
+    TARGET(INST_JUMP_LESS)
+        this->_quicken(*inst);
+        this->_compare_jump<InstructionType::INST_LESS>(*inst);
+        DISPATCH();
+    TARGET(INST_JUMP_GREATER)
+        this->_quicken(*inst);
+        this->_compare_jump<InstructionType::INST_GREATER>(*inst);
+        DISPATCH();
+    TARGET(INST_JUMP_LESS_EQ)
+        this->_quicken(*inst);
+        this->_compare_jump<InstructionType::INST_LESS_EQ>(*inst);
+        DISPATCH();
+    TARGET(INST_JUMP_GREATER_EQ)
+        this->_quicken(*inst);
+        this->_compare_jump<InstructionType::INST_GREATER_EQ>(*inst);
+        DISPATCH();
+    TARGET(INST_INC_VAR)
+        this->_inc_var_op(*inst);
+        DISPATCH();
+    TARGET(INST_ADD_IMM)
+        this->_add_imm_op(*inst);
+        DISPATCH();
+    TARGET(INST_PRINT_POP)
+        this->_print_op(false);
+        this->_stack.pop_back();
+        DISPATCH();
+    TARGET(INST_PRINTLN_POP)
+        this->_print_op(true);
+        this->_stack.pop_back();
+        DISPATCH();
+    // QUICKENED HANDLERS FOLLOW
+    TARGET(INST_ADD_INT)
+        if (!this->_arith_typed<InstructionType::INST_ADD, ValueType::TYPE_INT>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_SUB_INT)
+        if (!this->_arith_typed<InstructionType::INST_SUB, ValueType::TYPE_INT>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_MUL_INT)
+        if (!this->_arith_typed<InstructionType::INST_MUL, ValueType::TYPE_INT>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_DIV_INT)
+        if (!this->_arith_typed<InstructionType::INST_DIV, ValueType::TYPE_INT>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_MOD_INT)
+        if (!this->_arith_typed<InstructionType::INST_MOD, ValueType::TYPE_INT>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_ADD_FLOAT)
+        if (!this->_arith_typed<InstructionType::INST_ADD, ValueType::TYPE_FLOAT>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_SUB_FLOAT)
+        if (!this->_arith_typed<InstructionType::INST_SUB, ValueType::TYPE_FLOAT>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_MUL_FLOAT)
+        if (!this->_arith_typed<InstructionType::INST_MUL, ValueType::TYPE_FLOAT>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_DIV_FLOAT)
+        if (!this->_arith_typed<InstructionType::INST_DIV, ValueType::TYPE_FLOAT>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_NEQ_INT)
+        if (!this->_compare_typed<InstructionType::INST_NEQ, ValueType::TYPE_INT>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_EQ_INT)
+        if (!this->_compare_typed<InstructionType::INST_EQ, ValueType::TYPE_INT>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_LESS_INT)
+        if (!this->_compare_typed<InstructionType::INST_LESS, ValueType::TYPE_INT>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_GREATER_INT)
+        if (!this->_compare_typed<InstructionType::INST_GREATER, ValueType::TYPE_INT>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_LESS_EQ_INT)
+        if (!this->_compare_typed<InstructionType::INST_LESS_EQ, ValueType::TYPE_INT>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_GREATER_EQ_INT)
+        if (!this->_compare_typed<InstructionType::INST_GREATER_EQ, ValueType::TYPE_INT>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_NEQ_CHAR)
+        if (!this->_compare_typed<InstructionType::INST_NEQ, ValueType::TYPE_CHAR>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_EQ_CHAR)
+        if (!this->_compare_typed<InstructionType::INST_EQ, ValueType::TYPE_CHAR>())
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_JUMP_NEQ_INT)
+        if (!this->_compare_jump_int<InstructionType::INST_NEQ>(*inst))
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_JUMP_EQ_INT)
+        if (!this->_compare_jump_int<InstructionType::INST_EQ>(*inst))
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_JUMP_LESS_INT)
+        if (!this->_compare_jump_int<InstructionType::INST_LESS>(*inst))
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_JUMP_GREATER_INT)
+        if (!this->_compare_jump_int<InstructionType::INST_GREATER>(*inst))
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_JUMP_LESS_EQ_INT)
+        if (!this->_compare_jump_int<InstructionType::INST_LESS_EQ>(*inst))
+            DESPECIALIZE();
+        DISPATCH();
+    TARGET(INST_JUMP_GREATER_EQ_INT)
+        if (!this->_compare_jump_int<InstructionType::INST_GREATER_EQ>(*inst))
+            DESPECIALIZE();
+        DISPATCH();
+#ifdef EVO_COMPUTED_GOTO
+    // UNCHECKED HANDLERS FOLLOW
+    FAST_TARGET(INST_POP)
+        this->_pop_op<false>();
+        DISPATCH();
+    FAST_TARGET(INST_SWAP)
+        this->_swap_op<false>();
+        DISPATCH();
+    FAST_TARGET(INST_DUP)
+        this->_check_overflow();
+        this->_stack.push_back(this->_stack.back());
+        DISPATCH();
+    FAST_TARGET(INST_ADD)
+        this->_quicken(*inst);
+        this->_arith<InstructionType::INST_ADD, false>();
+        DISPATCH();
+    FAST_TARGET(INST_SUB)
+        this->_quicken(*inst);
+        this->_arith<InstructionType::INST_SUB, false>();
+        DISPATCH();
+    FAST_TARGET(INST_MUL)
+        this->_quicken(*inst);
+        this->_arith<InstructionType::INST_MUL, false>();
+        DISPATCH();
+    FAST_TARGET(INST_DIV)
+        this->_quicken(*inst);
+        this->_arith<InstructionType::INST_DIV, false>();
+        DISPATCH();
+    FAST_TARGET(INST_MOD)
+        this->_quicken(*inst);
+        this->_arith<InstructionType::INST_MOD, false>();
+        DISPATCH();
+    FAST_TARGET(INST_AND)
+        this->_logic<InstructionType::INST_AND, false>();
+        DISPATCH();
+    FAST_TARGET(INST_OR)
+        this->_logic<InstructionType::INST_OR, false>();
+        DISPATCH();
+    FAST_TARGET(INST_XOR)
+        this->_logic<InstructionType::INST_XOR, false>();
+        DISPATCH();
+    FAST_TARGET(INST_NOT)
+        this->_not_op<false>(*inst);
+        DISPATCH();
+    FAST_TARGET(INST_NEQ)
+        this->_quicken(*inst);
+        this->_compare<InstructionType::INST_NEQ, false>();
+        DISPATCH();
+    FAST_TARGET(INST_EQ)
+        this->_quicken(*inst);
+        this->_compare<InstructionType::INST_EQ, false>();
+        DISPATCH();
+    FAST_TARGET(INST_LESS)
+        this->_quicken(*inst);
+        this->_compare<InstructionType::INST_LESS, false>();
+        DISPATCH();
+    FAST_TARGET(INST_GREATER)
+        this->_quicken(*inst);
+        this->_compare<InstructionType::INST_GREATER, false>();
+        DISPATCH();
+    FAST_TARGET(INST_LESS_EQ)
+        this->_quicken(*inst);
+        this->_compare<InstructionType::INST_LESS_EQ, false>();
+        DISPATCH();
+    FAST_TARGET(INST_GREATER_EQ)
+        this->_quicken(*inst);
+        this->_compare<InstructionType::INST_GREATER_EQ, false>();
+        DISPATCH();
+    FAST_TARGET(INST_JUMPIF)
+        this->_jumpif_op<false>(*inst);
+        DISPATCH();
+    FAST_TARGET(INST_SET)
+        this->_set_op<false>(*inst);
+        DISPATCH();
+    FAST_TARGET(INST_PRINT)
+        this->_print_op<false>(false);
+        DISPATCH();
+    FAST_TARGET(INST_PRINTLN)
+        this->_print_op<false>(true);
+        DISPATCH();
+    FAST_TARGET(INST_AT)
+        this->_at_op<false>();
+        DISPATCH();
+    FAST_TARGET(INST_LEN)
+        this->_len_op<false>();
+        DISPATCH();
+    FAST_TARGET(INST_COND)
+        this->_cond_op<false>();
+        DISPATCH();
+    FAST_TARGET(INST_JUMP_NEQ)
+        this->_quicken(*inst);
+        this->_compare_jump<InstructionType::INST_NEQ, false>(*inst);
+        DISPATCH();
+    FAST_TARGET(INST_JUMP_EQ)
+        this->_quicken(*inst);
+        this->_compare_jump<InstructionType::INST_EQ, false>(*inst);
+        DISPATCH();
+    FAST_TARGET(INST_JUMP_LESS)
+        this->_quicken(*inst);
+        this->_compare_jump<InstructionType::INST_LESS, false>(*inst);
+        DISPATCH();
+    FAST_TARGET(INST_JUMP_GREATER)
+        this->_quicken(*inst);
+        this->_compare_jump<InstructionType::INST_GREATER, false>(*inst);
+        DISPATCH();
+    FAST_TARGET(INST_JUMP_LESS_EQ)
+        this->_quicken(*inst);
+        this->_compare_jump<InstructionType::INST_LESS_EQ, false>(*inst);
+        DISPATCH();
+    FAST_TARGET(INST_JUMP_GREATER_EQ)
+        this->_quicken(*inst);
+        this->_compare_jump<InstructionType::INST_GREATER_EQ, false>(*inst);
+        DISPATCH();
+    FAST_TARGET(INST_INC_VAR)
+        this->_inc_var_op<false>(*inst);
+        DISPATCH();
+    FAST_TARGET(INST_ADD_IMM)
+        this->_add_imm_op<false>(*inst);
+        DISPATCH();
+    FAST_TARGET(INST_PRINT_POP)
+        this->_print_op<false>(false);
+        this->_stack.pop_back();
+        DISPATCH();
+    FAST_TARGET(INST_PRINTLN_POP)
+        this->_print_op<false>(true);
+        this->_stack.pop_back();
+        DISPATCH();
+#else
+            default:
+                break;
+        }
+    }
+#endif
+}
+
+#undef INSTRUMENT_OP
+#undef TARGET
+#undef FAST_TARGET
+#undef DISPATCH_INDEX
+#undef DISPATCH
+#undef DESPECIALIZE
+
+// JIT FUNCTIONS FOLLOW
+// runs a single instruction, calling the same handlers as the threaded engine
+template <InstructionType OP, bool CHECKED>
+void Interpreter::_run_op(Instruction& inst){
+    if constexpr (OP == InstructionType::INST_NULL)
+        return;
+    else if constexpr (OP == InstructionType::INST_PUSH)
+        this->_push_op(inst);
+    else if constexpr (OP == InstructionType::INST_POP)
+        this->_pop_op<CHECKED>();
+    else if constexpr (OP == InstructionType::INST_CLEAR)
+        this->_stack.clear();
+    else if constexpr (OP == InstructionType::INST_PEEK)
+        this->_peek_op();
+    else if constexpr (OP == InstructionType::INST_SWAP)
+        this->_swap_op<CHECKED>();
+    else if constexpr (OP == InstructionType::INST_SIZE)
+        this->stack_push(Value(ValueType::TYPE_INT, static_cast<int>(this->_stack.size())));
+    else if constexpr (OP == InstructionType::INST_DUP)
+        this->stack_dup();
+    else if constexpr (OP >= InstructionType::INST_ADD && OP <= InstructionType::INST_MOD)
+        this->_arith<OP, CHECKED>();
+    else if constexpr (OP >= InstructionType::INST_AND && OP <= InstructionType::INST_XOR)
+        this->_logic<OP, CHECKED>();
+    else if constexpr (OP == InstructionType::INST_NOT)
+        this->_not_op<CHECKED>(inst);
+    else if constexpr (OP >= InstructionType::INST_NEQ && OP <= InstructionType::INST_GREATER_EQ)
+        this->_compare<OP, CHECKED>();
+    else if constexpr (OP == InstructionType::INST_CALL || OP == InstructionType::INST_JUMP){
+        if constexpr (OP == InstructionType::INST_CALL)
+            this->_push_return(this->_next_op);
+        this->_next_op = inst.arg.value().get_int() - 1;
+    }
+    else if constexpr (OP == InstructionType::INST_JUMPIF)
+        this->_jumpif_op<CHECKED>(inst);
+    else if constexpr (OP == InstructionType::INST_RET)
+        this->_next_op = this->_pop_return();
+    else if constexpr (OP == InstructionType::INST_GET)
+        this->_get_op(inst);
+    else if constexpr (OP == InstructionType::INST_SET)
+        this->_set_op<CHECKED>(inst);
+    else if constexpr (OP == InstructionType::INST_PRINT || OP == InstructionType::INST_PRINTLN)
+        this->_print_op<CHECKED>(OP == InstructionType::INST_PRINTLN);
+    else if constexpr (OP == InstructionType::INST_READ)
+        this->_read_op();
+    else if constexpr (OP == InstructionType::INST_READINT)
+        this->_readint_op();
+    else if constexpr (OP == InstructionType::INST_FLUSH)
+        this->_output.flush();
+    else if constexpr (OP == InstructionType::INST_AT)
+        this->_at_op<CHECKED>();
+    else if constexpr (OP == InstructionType::INST_LEN)
+        this->_len_op<CHECKED>();
+    else if constexpr (OP == InstructionType::INST_TYPE)
+        this->_valtype_op();
+    else if constexpr (OP == InstructionType::INST_CONVERT)
+        this->_convert_op();
+    else if constexpr (OP == InstructionType::INST_COND)
+        this->_cond_op<CHECKED>();
+    else if constexpr (OP >= InstructionType::INST_JUMP_NEQ && OP <= InstructionType::INST_JUMP_GREATER_EQ){
+        constexpr InstructionType COMPARE_OP {static_cast<InstructionType>(static_cast<int>(InstructionType::INST_NEQ) + static_cast<int>(OP) - static_cast<int>(InstructionType::INST_JUMP_NEQ))};
+        this->_compare_jump<COMPARE_OP, CHECKED>(inst);
+    }
+    else if constexpr (OP == InstructionType::INST_INC_VAR)
+        this->_inc_var_op<CHECKED>(inst);
+    else if constexpr (OP == InstructionType::INST_ADD_IMM)
+        this->_add_imm_op<CHECKED>(inst);
+    else if constexpr (OP == InstructionType::INST_PRINT_POP || OP == InstructionType::INST_PRINTLN_POP){
+        this->_print_op<CHECKED>(OP == InstructionType::INST_PRINTLN_POP);
+        this->_stack.pop_back();
+    }
+    // quickened instructions are only created by the threaded engine
+    else
+        throw std::runtime_error(std::format("Error on line {}: illegal instruction", this->_current_line()));
+}
+
+// runs an instruction for native code, errors are kept to be rethrown once the native code has returned
+template <InstructionType OP, bool CHECKED>
+int Interpreter::_jit_helper(void* context, Instruction* inst){
+    Interpreter* machine = static_cast<Interpreter*>(context);
+    size_t index = inst - machine->_instructions.data();
+    machine->_next_op = index;
+    try{
+        machine->_run_op<OP, CHECKED>(*inst);
+    }
+    catch (...){
+        machine->_jit_error = std::current_exception();
+        return -1;
+    }
+    return machine->_next_op != index;
+}
+
+// builds a table of helpers, one for each op code
+template <bool CHECKED, size_t... OPS>
+std::array<JitHelper, sizeof...(OPS)> Interpreter::_jit_helpers(std::index_sequence<OPS...>){
+    return {&Interpreter::_jit_helper<static_cast<InstructionType>(OPS), CHECKED>...};
+}
+
+/*
+    runs the loaded instructions one at a time through the JIT's helpers, counting how often each backward jump is
+    taken. once a jump passes the threshold, the loop from its target to the jump is compiled, and from then on the
+    loop runs as native code whenever the interpreter reaches any instruction in it
+*/
+void Interpreter::_run_jit(){
+    constexpr size_t INST_TYPE_COUNT {static_cast<size_t>(InstructionType::INST_COUNT)};
+    static const std::array<JitHelper, INST_TYPE_COUNT> checked_helpers {_jit_helpers<true>(std::make_index_sequence<INST_TYPE_COUNT>())};
+    static const std::array<JitHelper, INST_TYPE_COUNT> unchecked_helpers {_jit_helpers<false>(std::make_index_sequence<INST_TYPE_COUNT>())};
+    const size_t inst_count = this->_instructions.size();
+    std::vector<JitOp> ops;
+    for (const Instruction& inst : this->_instructions){
+        size_t op = static_cast<size_t>(inst.op_code);
+        ops.push_back({jit_action(inst.op_code), inst.verified ? unchecked_helpers[op] : checked_helpers[op]});
+    }
+    std::vector<unsigned> jump_counts(inst_count, 0);
+    std::vector<JitRegion*> entries(inst_count, nullptr);
+    std::vector<std::unique_ptr<JitRegion>> regions;
+    while (this->_next_op < inst_count){
+        size_t index = this->_next_op;
+        if (entries[index] != nullptr){
+            long next_op = entries[index]->run(this, this->_stack, index);
+            if (next_op < 0)
+                std::rethrow_exception(this->_jit_error);
+            this->_next_op = next_op;
+            continue;
+        }
+        Instruction& inst = this->_instructions[index];
+        if (ops[index].helper(this, &inst) < 0)
+            std::rethrow_exception(this->_jit_error);
+        this->_next_op++;
+        if (!is_jump(inst.op_code) || this->_next_op > index || ++jump_counts[this->_next_op] != JIT_THRESHOLD)
+            continue;
+        std::unique_ptr<JitRegion> region = JitRegion::compile(this->_instructions, this->_next_op, index, ops, this->_vars.data());
+        if (region == nullptr)
+            continue;
+        for (size_t i = this->_next_op; i <= index; i++){
+            if (ops[i].action != JitAction::JIT_EXIT)
+                entries[i] = region.get();
+        }
+        regions.push_back(std::move(region));
+    }
+}
+
+// REGISTER INSTRUCTIONS FOLLOW
+// runs a binary operation on two registers, the destination may be either operand
+template <InstructionType OP>
+void Interpreter::_reg_binary(Value* regs, const RegInstruction& inst){
+    const Value& right = regs[inst.b];
+    if constexpr (OP >= InstructionType::INST_NEQ){
+        regs[inst.dest] = Value(ValueType::TYPE_BOOL, this->_reg_compare<OP>(regs[inst.a], right));
+        return;
+    }
+    // ints are the common case, and can't raise an error unless they're divided
+    if constexpr (OP == InstructionType::INST_ADD || OP == InstructionType::INST_SUB || OP == InstructionType::INST_MUL){
+        const Value& left = regs[inst.a];
+        if (left.get_type() == ValueType::TYPE_INT && right.get_type() == ValueType::TYPE_INT){
+            int lhs {left.get_int()}, rhs {right.get_int()};
+            int result = (OP == InstructionType::INST_ADD) ? lhs + rhs : (OP == InstructionType::INST_SUB) ? lhs - rhs : lhs * rhs;
+            regs[inst.dest] = Value(ValueType::TYPE_INT, result);
+            return;
+        }
+    }
+    // the left operand is copied unless it's also the destination, so the destination is only written once the result is known
+    Value result;
+    if (inst.dest != inst.a)
+        result = regs[inst.a];
+    Value& left = (inst.dest == inst.a) ? regs[inst.dest] : result;
+    if constexpr (OP >= InstructionType::INST_AND){
+        try{
+            logic_values<OP>(left, right);
+        }
+        catch (const std::runtime_error& e){
+            throw std::runtime_error(std::format("Error on line {}: {}", this->_current_line(), e.what()));
+        }
+    }
+    else
+        this->_arith_values<OP>(left, right);
+    if (inst.dest != inst.a)
+        regs[inst.dest] = std::move(result);
+}
+
+// compares two registers, comparing ints directly
+template <InstructionType OP>
+bool Interpreter::_reg_compare(const Value& left_val, const Value& right_val){
+    if (left_val.get_type() == ValueType::TYPE_INT && right_val.get_type() == ValueType::TYPE_INT)
+        return compare_ints<OP>(left_val.get_int(), right_val.get_int());
+    return this->_compare_values<OP>(left_val, right_val);
+}
+
+// runs register code until it halts
+void Interpreter::_run_register_code(const RegisterProgram& program, Value* regs){
+    const RegInstruction* code = program.code.data();
+    size_t pc {0};
+    while (true){
+        const RegInstruction& inst = code[pc++];
+        // a single store, so errors and samples can find the instruction without pc being kept in memory
+        this->_reg_pc = pc;
+        switch (inst.op){
+            case RegOp::REG_MOVE:
+                regs[inst.dest] = regs[inst.a];
+                break;
+            case RegOp::REG_GET:
+                if (regs[inst.a].get_type() == ValueType::TYPE_NULL)
+                    throw std::runtime_error(std::format("Error on line {}: Variable \"{}\" is undeclared", this->_current_line(), this->_parser.var_names()[inst.a]));
+                regs[inst.dest] = regs[inst.a];
+                break;
+            case RegOp::REG_SWAP:
+                std::swap(regs[inst.a], regs[inst.b]);
+                break;
+            case RegOp::REG_PEEK:{
+                const Value& index = regs[inst.a];
+                if (index.get_type() != ValueType::TYPE_INT)
+                    throw std::runtime_error(std::format("Value Error on line {}: Invalid value type for peek index", this->_current_line()));
+                if (static_cast<size_t>(index.get_int()) >= inst.b)
+                    throw std::runtime_error(std::format("Range Error on line {}: Index for peek instruction out of range", this->_current_line()));
+                regs[inst.dest] = regs[program.stack_base + inst.b - (1 + index.get_int())];
+                break;
+            }
+            case RegOp::REG_ADD: this->_reg_binary<InstructionType::INST_ADD>(regs, inst); break;
+            case RegOp::REG_SUB: this->_reg_binary<InstructionType::INST_SUB>(regs, inst); break;
+            case RegOp::REG_MUL: this->_reg_binary<InstructionType::INST_MUL>(regs, inst); break;
+            case RegOp::REG_DIV: this->_reg_binary<InstructionType::INST_DIV>(regs, inst); break;
+            case RegOp::REG_MOD: this->_reg_binary<InstructionType::INST_MOD>(regs, inst); break;
+            case RegOp::REG_AND: this->_reg_binary<InstructionType::INST_AND>(regs, inst); break;
+            case RegOp::REG_OR: this->_reg_binary<InstructionType::INST_OR>(regs, inst); break;
+            case RegOp::REG_XOR: this->_reg_binary<InstructionType::INST_XOR>(regs, inst); break;
+            case RegOp::REG_NEQ: this->_reg_binary<InstructionType::INST_NEQ>(regs, inst); break;
+            case RegOp::REG_EQ: this->_reg_binary<InstructionType::INST_EQ>(regs, inst); break;
+            case RegOp::REG_LESS: this->_reg_binary<InstructionType::INST_LESS>(regs, inst); break;
+            case RegOp::REG_GREATER: this->_reg_binary<InstructionType::INST_GREATER>(regs, inst); break;
+            case RegOp::REG_LESS_EQ: this->_reg_binary<InstructionType::INST_LESS_EQ>(regs, inst); break;
+            case RegOp::REG_GREATER_EQ: this->_reg_binary<InstructionType::INST_GREATER_EQ>(regs, inst); break;
+            case RegOp::REG_NOT:
+                try{
+                    regs[inst.dest] = Value(ValueType::TYPE_BOOL, not_value(regs[inst.a]));
+                }
+                catch (const std::runtime_error& e){
+                    throw std::runtime_error(std::format("Error on line {}: {}", this->_current_line(), e.what()));
+                }
+                break;
+            case RegOp::REG_INC_VAR:
+                if (regs[inst.dest].get_type() == ValueType::TYPE_NULL)
+                    throw std::runtime_error(std::format("Error on line {}: Variable \"{}\" is undeclared", this->_current_line(), this->_parser.var_names()[inst.dest]));
+                this->_arith_values<InstructionType::INST_ADD>(regs[inst.dest], regs[inst.b]);
+                break;
+            case RegOp::REG_JUMP:
+                pc = inst.target;
+                break;
+            case RegOp::REG_JUMPIF:
+                if (regs[inst.a].as_int())
+                    pc = inst.target;
+                break;
+            case RegOp::REG_JUMP_NEQ:
+                if (this->_reg_compare<InstructionType::INST_NEQ>(regs[inst.a], regs[inst.b]))
+                    pc = inst.target;
+                break;
+            case RegOp::REG_JUMP_EQ:
+                if (this->_reg_compare<InstructionType::INST_EQ>(regs[inst.a], regs[inst.b]))
+                    pc = inst.target;
+                break;
+            case RegOp::REG_JUMP_LESS:
+                if (this->_reg_compare<InstructionType::INST_LESS>(regs[inst.a], regs[inst.b]))
+                    pc = inst.target;
+                break;
+            case RegOp::REG_JUMP_GREATER:
+                if (this->_reg_compare<InstructionType::INST_GREATER>(regs[inst.a], regs[inst.b]))
+                    pc = inst.target;
+                break;
+            case RegOp::REG_JUMP_LESS_EQ:
+                if (this->_reg_compare<InstructionType::INST_LESS_EQ>(regs[inst.a], regs[inst.b]))
+                    pc = inst.target;
+                break;
+            case RegOp::REG_JUMP_GREATER_EQ:
+                if (this->_reg_compare<InstructionType::INST_GREATER_EQ>(regs[inst.a], regs[inst.b]))
+                    pc = inst.target;
+                break;
+            // return addresses are kept as stack instruction indexes, so they mean the same thing to every engine
+            case RegOp::REG_CALL:
+                this->_push_return(inst.c);
+                pc = inst.target;
+                break;
+            case RegOp::REG_RET:
+                pc = program.entry_points[std::min(this->_pop_return() + 1, program.entry_points.size() - 1)];
+                break;
+            case RegOp::REG_PRINT:
+                this->_print_value(regs[inst.a], inst.b);
+                break;
+            case RegOp::REG_READ:
+                regs[inst.dest] = Value(ValueType::TYPE_STR, this->_read_line());
+                break;
+            case RegOp::REG_READINT:
+                regs[inst.dest] = this->_read_int();
+                break;
+            case RegOp::REG_FLUSH:
+                this->_output.flush();
+                break;
+            case RegOp::REG_AT:{
+                const Value& index = regs[inst.a];
+                if (index.get_type() != ValueType::TYPE_INT)
+                    throw std::runtime_error(std::format("Error on line {}: Index values must be of integer type", this->_current_line()));
+                try{
+                    regs[inst.dest] = regs[inst.b].get_index(index.as_int());
+                }
+                catch (std::out_of_range e){
+                    throw std::runtime_error(std::format("Range Error on line {}: Index out of range.", this->_current_line()));
+                }
+                catch (std::runtime_error e){
+                    throw std::runtime_error(std::format("Error on line {}: {}", this->_current_line(), e.what()));
+                }
+                break;
+            }
+            case RegOp::REG_LEN:
+                try{
+                    regs[inst.dest] = Value(ValueType::TYPE_INT, static_cast<int>(regs[inst.a].get_len()));
+                }
+                catch (std::runtime_error e){
+                    throw std::runtime_error(std::format("Error on line {}: {}", this->_current_line(), e.what()));
+                }
+                break;
+            case RegOp::REG_TYPE:
+                regs[inst.dest] = Value(ValueType::TYPE_VALTYPE, static_cast<int>(regs[inst.a].get_type()));
+                break;
+            case RegOp::REG_CONVERT:{
+                const Value& type = regs[inst.b];
+                if (type.get_type() != ValueType::TYPE_VALTYPE)
+                    throw std::runtime_error(std::format("Type Error on line {}: Invalid type for conversion", this->_current_line()));
+                try{
+                    regs[inst.dest] = convert_value(regs[inst.a], static_cast<ValueType>(type.get_int()));
+                }
+                catch (std::runtime_error e){
+                    throw std::runtime_error(std::format("Error on line {}: {}", this->_current_line(), e.what()));
+                }
+                catch (const std::invalid_argument & e) {
+                    throw std::runtime_error(std::format("Value Error on line {}: Non-integer input recived for readint", this->_current_line()));
+                }
+                catch (const std::out_of_range & e) {
+                    throw std::runtime_error(std::format("Value Error on line {}: Out-of-range input recived for readint", this->_current_line()));
+                }
+                break;
+            }
+            case RegOp::REG_COND:
+                regs[inst.dest] = Value(regs[inst.a].as_bool() ? regs[inst.b] : regs[inst.c]);
+                break;
+            case RegOp::REG_HALT:
+                return;
+        }
     }
 }
 
-// runs a single expression, and returns the top value remaining on the stack, or an empty value if the stack is empty
+/*
+    translates the loaded instructions to register code and runs it. the variables and the stack are moved into the
+    register file first, and moved back out once the program halts. if the program can't be translated, it runs with
+    the threaded engine instead
+*/
+void Interpreter::_run_registers(){
+    std::optional<RegisterProgram> translated;
+    // translating isn't running any instruction, which samples taken meanwhile should show
+    this->_executing = false;
+    if (this->_next_op == 0)
+        translated = translate_to_registers(this->_instructions, this->_stack.size(), this->_vars, this->_stack.capacity());
+    this->_executing = true;
+    if (!translated.has_value()){
+        this->_run_threaded();
+        return;
+    }
+    const RegisterProgram& program = translated.value();
+    std::vector<Value> regs(program.const_base + program.constants.size());
+    std::move(this->_vars.begin(), this->_vars.end(), regs.begin());
+    for (size_t i = 0; i < this->_stack.size(); i++)
+        regs[program.stack_base + i] = std::move(this->_stack[i]);
+    this->_stack.clear();
+    std::copy(program.constants.begin(), program.constants.end(), regs.begin() + program.const_base);
+    this->_reg_program = &program;
+    // an error ends the program, so only the variables are kept when one is raised
+    try{
+        this->_run_register_code(program, regs.data());
+    }
+    catch (...){
+        this->_reg_program = nullptr;
+        std::move(regs.begin(), regs.begin() + this->_vars.size(), this->_vars.begin());
+        throw;
+    }
+    this->_reg_program = nullptr;
+    std::move(regs.begin(), regs.begin() + this->_vars.size(), this->_vars.begin());
+    for (size_t i = 0; i < program.exit_depth; i++)
+        this->_stack.push_back(std::move(regs[program.stack_base + i]));
+    this->_next_op = this->_instructions.size();
+}
+
+/*
+    the register instruction being run is the one before the program counter, and it was translated from the last
+    stack instruction whose register code starts at or before it. the JIT doesn't update the next op while running
+    native code, so a loop running natively is seen at the instruction it was entered at
+*/
+size_t Interpreter::_op_address() const{
+    const RegisterProgram* program = this->_reg_program;
+    if (program == nullptr)
+        return this->_next_op;
+    const std::vector<uint32_t>& entries = program->entry_points;
+    size_t pc = this->_reg_pc ? this->_reg_pc - 1 : 0;
+    size_t index = std::upper_bound(entries.begin(), entries.end(), pc) - entries.begin();
+    return index ? index - 1 : 0;
+}
+
+size_t Interpreter::current_op() const{
+    if (!this->_executing)
+        return NOT_RUNNING;
+    return this->_op_address();
+}
+
+// allocates a slot for every variable known to the parser, keeping the values of existing variables
+void Interpreter::_load_vars(){
+    this->_vars.resize(this->_parser.var_names().size());
+}
+
+// returns the nanoseconds since a point in time
+static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// runs the loaded instructions from the next op
+void Interpreter::_execute(){
+    auto start = std::chrono::steady_clock::now();
+    // the count of string bytes is shared by everything on this thread, so only what's created during the run is kept
+    uint64_t string_bytes = string_bytes_allocated;
+    // the time and strings of a run are counted, and its output written, whether or not it raises an error
+    auto finish = [&](){
+        this->_executing = false;
+        this->_output.flush();
+        this->_stats.exec_ns += elapsed_ns(start);
+        this->_stats.string_bytes += string_bytes_allocated - string_bytes;
+    };
+    this->_executing = true;
+    try{
+        this->_run_engine();
+    }
+    catch (...){
+        finish();
+        throw;
+    }
+    finish();
+}
+
+// runs the loaded instructions with the selected engine, or the loop engine if every instruction is profiled,
+// or the threaded engine if they're counted or traced
+void Interpreter::_run_engine(){
+    // profiling, counting and tracing need work done for every instruction, so they have their own copies of the engines
+    if (this->_profile){
+        this->_profiler.resize(this->_instructions.size());
+        if (this->_collect_stats)
+            this->_run_bytecode<true, true>();
+        else
+            this->_run_bytecode<false, true>();
+        return;
+    }
+    bool tracing = this->_trace != nullptr;
+    if (this->_collect_stats || tracing){
+        if (this->_collect_stats && tracing)
+            this->_run_threaded<true, true>();
+        else if (tracing)
+            this->_run_threaded<false, true>();
+        else
+            this->_run_threaded<true>();
+        return;
+    }
+    switch (this->_engine){
+        case ExecEngine::ENGINE_LOOP:
+            this->_run_bytecode();
+            break;
+        case ExecEngine::ENGINE_THREADED:
+            this->_run_threaded();
+            break;
+        case ExecEngine::ENGINE_JIT:
+            this->_run_jit();
+            break;
+        case ExecEngine::ENGINE_REGISTER:
+            this->_run_registers();
+            break;
+    }
+}
+
+/*
+    runs a single expression, and returns the top value remaining on the stack, or an empty value if the stack is empty.
+    each expression is appended to the code of every earlier one, so labels declared by earlier expressions can be
+    jumped to. an expression that jumps to a label that hasn't been declared yet waits, along with every expression
+    after it, until the label is declared, and then they run in order, or until discard_pending drops them
+*/
 Value Interpreter::run_expr(std::string expr){
-    this->_next_op = 0;
+    // the tokens refer to expr, which outlives them as parsing finishes before this returns
+    auto start = std::chrono::steady_clock::now();
     std::vector<Token> tokens = tokenize_expr(expr);
-    this->_parser.set_tokens(tokens);
-    this->_instructions = this->_parser.parse_expr(true);
-    this->_run_bytecode();
+    this->_stats.lex_ns += elapsed_ns(start);
+    start = std::chrono::steady_clock::now();
+    // the first expression to wait on a label starts the run of expressions that discard_pending drops
+    if (this->_resume_op == this->_instructions.size())
+        this->_pending_mark = this->_parser.mark(this->_instructions);
+    bool resolved = this->_parser.parse_append(tokens, this->_instructions);
+    this->_stats.parse_ns += elapsed_ns(start);
+    this->_load_vars();
+    if (resolved){
+        this->_next_op = this->_resume_op;
+        // an expression that raises an error isn't run again by the next one
+        this->_resume_op = this->_instructions.size();
+        this->_execute();
+    }
     if (this->_stack.empty())
         return Value(ValueType::TYPE_NULL, "");
     return this->stack_top();
 }
 
+// drops every expression that is waiting on a label to be declared, along with the labels and variables they declared
+void Interpreter::discard_pending(){
+    if (this->_resume_op == this->_instructions.size())
+        return;
+    this->_parser.rollback(this->_pending_mark, this->_instructions);
+    this->_vars.resize(this->_parser.var_names().size());
+}
+
 // runs a multiline program, treating each line as an expression. returns the top value remaining on the stack, or an empty value if the stack is empty
-// TODO: Make this keep track of line number
-Value Interpreter::run_prog(std::stringstream& program){
+Value Interpreter::run_prog(std::string_view source){
+    return this->run_compiled(this->compile_prog(source));
+}
+
+// parses a multiline program without running it
+CompiledProgram Interpreter::compile_prog(std::string_view source){
+    CompiledProgram program;
+    // the tokens refer to the source, which outlives them as parsing finishes before this returns
+    auto start = std::chrono::steady_clock::now();
+    TokenizedProgram tokens = tokenize_program(source);
+    this->_stats.lex_ns += elapsed_ns(start);
+    start = std::chrono::steady_clock::now();
+    this->_parser.reset();
+    program.instructions = this->_parser.parse_program(tokens);
+    this->_stats.parse_ns += elapsed_ns(start);
+    program.var_names = this->_parser.var_names();
+    program.labels = this->_parser.labels();
+    program.lines = this->_parser.lines();
+    return program;
+}
+
+// runs a program that has already been parsed, returns the top value remaining on the stack, or an empty value if the stack is empty
+Value Interpreter::run_compiled(CompiledProgram program){
     this->_next_op = 0;
-    std::vector<std::vector<Token>> tokens = tokenize_program(program);
     this->_parser.reset();
-    this->_instructions = this->_parser.parse_program(tokens);
-    this->_run_bytecode();
+    this->_parser.declare_vars(program.var_names);
+    this->_parser.set_lines(std::move(program.lines));
+    this->_instructions = std::move(program.instructions);
+    this->_labels = std::move(program.labels);
+    this->_profiler.clear();
+    if (this->_verify)
+        verify_bytecode(this->_instructions, this->_stack.size());
+    // resetting the parser forgets every variable, so the values of any earlier variables are discarded with them
+    this->_vars.clear();
+    this->_load_vars();
+    this->_execute();
     if (this->_stack.empty())
         return Value(ValueType::TYPE_NULL, "");
     return this->stack_pop();
@@ -519,9 +1754,29 @@ Value Interpreter::run_prog(std::stringstream& program){
 // resets the interpreter's state
 void Interpreter::reset_state(){
     this->_return_addrs.clear();
-    this->_line_no = 0;
     this->_next_op = 0;
+    this->_resume_op = 0;
+    this->_pending_mark = {};
     this->_parser.reset();
     this->_instructions.clear();
     this->_vars.clear();
-}
\ No newline at end of file
+    this->_labels.clear();
+    this->_profiler.clear();
+    this->_stats = InterpreterStats();
+}
+
+InterpreterStats Interpreter::stats() const{
+    InterpreterStats stats = this->_stats;
+    // the stack is only measured before each instruction, so the depth the last one left it at is added here
+    stats.peak_stack = std::max(stats.peak_stack, this->_stack.size());
+    stats.variables = this->_vars.size();
+    stats.live_variables = std::count_if(this->_vars.begin(), this->_vars.end(), [](const Value& var){return var.get_type() != ValueType::TYPE_NULL;});
+    return stats;
+}
+
+void Interpreter::write_stats(std::ostream& out) const{
+    InterpreterStats stats = this->stats();
+    out << std::format("{{\n  \"instructions\": {},\n  \"peak_stack_depth\": {},\n  \"peak_call_depth\": {},\n", stats.instructions, stats.peak_stack, stats.peak_calls);
+    out << std::format("  \"variables\": {},\n  \"live_variables\": {},\n  \"string_bytes\": {},\n", stats.variables, stats.live_variables, stats.string_bytes);
+    out << std::format("  \"lex_ns\": {},\n  \"parse_ns\": {},\n  \"exec_ns\": {}\n}}", stats.lex_ns, stats.parse_ns, stats.exec_ns) << std::endl;
+}
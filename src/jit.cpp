@@ -0,0 +1,546 @@
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <bit>
+#include <initializer_list>
+#include "../inc/value.hpp"
+#include "../inc/value_stack.hpp"
+#include "../inc/instruction.hpp"
+#include "../inc/jit.hpp"
+
+#if defined(__x86_64__) && defined(__linux__) && !defined(EVO_NO_JIT)
+    #define EVO_JIT_X86_64
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+JitAction jit_action(InstructionType op_code){
+    switch (op_code){
+        case InstructionType::INST_JUMP:
+            return JitAction::JIT_JUMP;
+        // calls and returns move between loops, and I/O is left to the interpreter
+        case InstructionType::INST_CALL:
+        case InstructionType::INST_RET:
+        case InstructionType::INST_PRINT:
+        case InstructionType::INST_PRINTLN:
+        case InstructionType::INST_READ:
+        case InstructionType::INST_READINT:
+        case InstructionType::INST_FLUSH:
+        case InstructionType::INST_PRINT_POP:
+        case InstructionType::INST_PRINTLN_POP:
+            return JitAction::JIT_EXIT;
+        default:
+            return is_jump(op_code) ? JitAction::JIT_BRANCH : JitAction::JIT_HELPER;
+    }
+}
+
+bool jit_supported(){
+#ifdef EVO_JIT_X86_64
+    return true;
+#else
+    return false;
+#endif
+}
+
+JitRegion::~JitRegion(){
+#ifdef EVO_JIT_X86_64
+    if (this->_code != nullptr)
+        munmap(this->_code, this->_code_size);
+#endif
+}
+
+#ifdef EVO_JIT_X86_64
+// the registers used by the templates, rbx holds the helpers' context and r12 holds the stack for the whole region
+enum Register : uint8_t{
+    REG_RAX = 0,
+    REG_RCX = 1,
+    REG_RDX = 2,
+    REG_RSI = 6
+};
+
+// condition codes, as used by jcc and setcc
+enum Condition : uint8_t{
+    COND_B = 0x2,
+    COND_AE = 0x3,
+    COND_E = 0x4,
+    COND_NE = 0x5,
+    COND_S = 0x8,
+    COND_GE = 0xd,
+    COND_LE = 0xe,
+    COND_G = 0xf
+};
+
+// the offsets templates use to reach values, rax holds the address just past the top of the stack
+static_assert(sizeof(Value) == 16, "the JIT's templates expect 16 byte values");
+const int8_t TYPE_OFFSET = Value::type_offset();
+const int8_t DATA_OFFSET = Value::data_offset();
+const int8_t TOP_TYPE = TYPE_OFFSET - 16;
+const int8_t TOP_DATA = DATA_OFFSET - 16;
+const int8_t SECOND_TYPE = TYPE_OFFSET - 32;
+const int8_t SECOND_DATA = DATA_OFFSET - 32;
+const int8_t STACK_DATA = ValueStack::data_offset();
+const int8_t STACK_SIZE = ValueStack::size_offset();
+const int8_t STACK_CAPACITY = ValueStack::capacity_offset();
+
+// returns a bit mask of value types, for testing a type with bt
+static uint32_t type_mask(std::initializer_list<ValueType> types){
+    uint32_t mask {0};
+    for (ValueType type : types)
+        mask |= 1u << static_cast<unsigned>(type);
+    return mask;
+}
+
+// a buffer of x86-64 machine code, with the few instructions the templates need
+class CodeBuffer{
+    private:
+        std::vector<uint8_t> _bytes;
+        void _value_operand(uint8_t reg, Register base, int8_t disp);
+        void _stack_operand(uint8_t reg, int8_t disp);
+    public:
+        size_t size() const {return this->_bytes.size();}
+        const uint8_t* data() const {return this->_bytes.data();}
+        void emit(std::initializer_list<uint8_t> bytes) {this->_bytes.insert(this->_bytes.end(), bytes);}
+        void emit_imm32(uint32_t val);
+        void emit_imm64(uint64_t val);
+        void patch_rel32(size_t pos, size_t target);
+        // emits a jump with a 32 bit offset, returning the position of the offset so it can be patched
+        size_t emit_jump();
+        size_t emit_jcc(Condition cond);
+        // emits code that returns the given value to the interpreter
+        void emit_return(uint32_t val);
+        void emit_error_return();
+        void emit_helper_call(Instruction* inst, JitHelper helper);
+        // stack templates
+        void load_stack_end();
+        void check_size(uint8_t count, std::vector<size_t>& slow_jumps);
+        void check_room(std::vector<size_t>& slow_jumps);
+        void adjust_size(int8_t change);
+        // value templates
+        void load_var(Value* var);
+        void check_type(Register base, int8_t disp, ValueType type, std::vector<size_t>& slow_jumps);
+        void check_type_in(Register base, int8_t disp, uint32_t mask, bool allowed, std::vector<size_t>& slow_jumps);
+        void load_int(Register reg, Register base, int8_t disp);
+        void int_op(uint8_t opcode, Register base, int8_t disp, Register reg);
+        void copy_value(Register dest, int8_t dest_disp, Register src, int8_t src_disp);
+        void store_type(Register base, int8_t disp, ValueType type);
+        void store_imm32(Register base, int8_t disp, uint32_t val);
+        void add_imm32(Register base, int8_t disp, uint32_t val);
+};
+
+void CodeBuffer::emit_imm32(uint32_t val){
+    for (int i = 0; i < 4; i++)
+        this->_bytes.push_back((val >> (i * 8)) & 0xff);
+}
+
+void CodeBuffer::emit_imm64(uint64_t val){
+    for (int i = 0; i < 8; i++)
+        this->_bytes.push_back((val >> (i * 8)) & 0xff);
+}
+
+void CodeBuffer::patch_rel32(size_t pos, size_t target){
+    uint32_t rel = static_cast<uint32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(pos + 4));
+    std::memcpy(&this->_bytes[pos], &rel, 4);
+}
+
+// the modrm byte and displacement for [base + disp]
+void CodeBuffer::_value_operand(uint8_t reg, Register base, int8_t disp){
+    this->emit({static_cast<uint8_t>(0x40 | (reg << 3) | base), static_cast<uint8_t>(disp)});
+}
+
+// the modrm byte, sib byte and displacement for [r12 + disp]
+void CodeBuffer::_stack_operand(uint8_t reg, int8_t disp){
+    this->emit({static_cast<uint8_t>(0x44 | (reg << 3)), 0x24, static_cast<uint8_t>(disp)});
+}
+
+size_t CodeBuffer::emit_jump(){
+    this->emit({0xe9});                                     // jmp rel32
+    size_t pos = this->size();
+    this->emit_imm32(0);
+    return pos;
+}
+
+size_t CodeBuffer::emit_jcc(Condition cond){
+    this->emit({0x0f, static_cast<uint8_t>(0x80 | cond)});  // jcc rel32
+    size_t pos = this->size();
+    this->emit_imm32(0);
+    return pos;
+}
+
+void CodeBuffer::emit_return(uint32_t val){
+    this->emit({0xb8});                                     // mov eax, val
+    this->emit_imm32(val);
+    this->emit({0x48, 0x83, 0xc4, 0x08});                   // add rsp, 8
+    this->emit({0x41, 0x5c, 0x5b, 0xc3});                   // pop r12; pop rbx; ret
+}
+
+void CodeBuffer::emit_error_return(){
+    this->emit({0x48, 0xc7, 0xc0, 0xff, 0xff, 0xff, 0xff}); // mov rax, -1
+    this->emit({0x48, 0x83, 0xc4, 0x08});                   // add rsp, 8
+    this->emit({0x41, 0x5c, 0x5b, 0xc3});                   // pop r12; pop rbx; ret
+}
+
+// calls an instruction's helper, leaving its result in eax
+void CodeBuffer::emit_helper_call(Instruction* inst, JitHelper helper){
+    this->emit({0x48, 0x89, 0xdf});                         // mov rdi, rbx
+    this->emit({0x48, 0xbe});                               // mov rsi, inst
+    this->emit_imm64(reinterpret_cast<uint64_t>(inst));
+    this->emit({0x48, 0xb8});                               // mov rax, helper
+    this->emit_imm64(reinterpret_cast<uint64_t>(helper));
+    this->emit({0xff, 0xd0});                               // call rax
+    this->emit({0x85, 0xc0});                               // test eax, eax
+}
+
+// loads the address just past the top of the stack into rax
+void CodeBuffer::load_stack_end(){
+    this->emit({0x49, 0x8b});                               // mov rax, [r12 + data]
+    this->_stack_operand(REG_RAX, STACK_DATA);
+    this->emit({0x49, 0x8b});                               // mov rcx, [r12 + size]
+    this->_stack_operand(REG_RCX, STACK_SIZE);
+    this->emit({0x48, 0xc1, 0xe1, 0x04});                   // shl rcx, 4
+    this->emit({0x48, 0x01, 0xc8});                         // add rax, rcx
+}
+
+// takes the slow path if the stack holds less than count values
+void CodeBuffer::check_size(uint8_t count, std::vector<size_t>& slow_jumps){
+    this->emit({0x49, 0x83});                               // cmp qword [r12 + size], count
+    this->_stack_operand(7, STACK_SIZE);
+    this->emit({count});
+    slow_jumps.push_back(this->emit_jcc(COND_B));
+}
+
+// takes the slow path if there's no room on the stack for another value, so the helper reports the overflow
+void CodeBuffer::check_room(std::vector<size_t>& slow_jumps){
+    this->emit({0x49, 0x8b});                               // mov rcx, [r12 + size]
+    this->_stack_operand(REG_RCX, STACK_SIZE);
+    this->emit({0x49, 0x3b});                               // cmp rcx, [r12 + capacity]
+    this->_stack_operand(REG_RCX, STACK_CAPACITY);
+    slow_jumps.push_back(this->emit_jcc(COND_AE));
+}
+
+void CodeBuffer::adjust_size(int8_t change){
+    if (change == 1 || change == -1){
+        this->emit({0x49, 0xff});                           // inc/dec qword [r12 + size]
+        this->_stack_operand(change == 1 ? 0 : 1, STACK_SIZE);
+        return;
+    }
+    this->emit({0x49, 0x83});                               // add qword [r12 + size], change
+    this->_stack_operand(0, STACK_SIZE);
+    this->emit({static_cast<uint8_t>(change)});
+}
+
+// loads a variable's address into rsi
+void CodeBuffer::load_var(Value* var){
+    this->emit({0x48, 0xbe});                               // mov rsi, var
+    this->emit_imm64(reinterpret_cast<uint64_t>(var));
+}
+
+// takes the slow path if a value isn't of the given type
+void CodeBuffer::check_type(Register base, int8_t disp, ValueType type, std::vector<size_t>& slow_jumps){
+    this->emit({0x80});                                     // cmp byte [base + disp], type
+    this->_value_operand(7, base, disp);
+    this->emit({static_cast<uint8_t>(type)});
+    slow_jumps.push_back(this->emit_jcc(COND_NE));
+}
+
+// takes the slow path if a value's type is in (or, if allowed is set, isn't in) a mask of types
+void CodeBuffer::check_type_in(Register base, int8_t disp, uint32_t mask, bool allowed, std::vector<size_t>& slow_jumps){
+    this->emit({0x0f, 0xb6});                               // movzx ecx, byte [base + disp]
+    this->_value_operand(REG_RCX, base, disp);
+    this->emit({0xba});                                     // mov edx, mask
+    this->emit_imm32(mask);
+    this->emit({0x0f, 0xa3, 0xca});                         // bt edx, ecx
+    slow_jumps.push_back(this->emit_jcc(allowed ? COND_AE : COND_B));
+}
+
+void CodeBuffer::load_int(Register reg, Register base, int8_t disp){
+    this->emit({0x8b});                                     // mov reg, dword [base + disp]
+    this->_value_operand(reg, base, disp);
+}
+
+// applies a two operand instruction to an int in memory, such as add, sub or mov
+void CodeBuffer::int_op(uint8_t opcode, Register base, int8_t disp, Register reg){
+    this->emit({opcode});                                   // op dword [base + disp], reg
+    this->_value_operand(reg, base, disp);
+}
+
+void CodeBuffer::copy_value(Register dest, int8_t dest_disp, Register src, int8_t src_disp){
+    this->emit({0x48, 0x8b});                               // mov rcx, [src + src_disp]
+    this->_value_operand(REG_RCX, src, src_disp);
+    this->emit({0x48, 0x8b});                               // mov rdx, [src + src_disp + 8]
+    this->_value_operand(REG_RDX, src, src_disp + 8);
+    this->emit({0x48, 0x89});                               // mov [dest + dest_disp], rcx
+    this->_value_operand(REG_RCX, dest, dest_disp);
+    this->emit({0x48, 0x89});                               // mov [dest + dest_disp + 8], rdx
+    this->_value_operand(REG_RDX, dest, dest_disp + 8);
+}
+
+void CodeBuffer::store_type(Register base, int8_t disp, ValueType type){
+    this->emit({0xc6});                                     // mov byte [base + disp], type
+    this->_value_operand(0, base, disp);
+    this->emit({static_cast<uint8_t>(type)});
+}
+
+void CodeBuffer::store_imm32(Register base, int8_t disp, uint32_t val){
+    this->emit({0xc7});                                     // mov dword [base + disp], val
+    this->_value_operand(0, base, disp);
+    this->emit_imm32(val);
+}
+
+void CodeBuffer::add_imm32(Register base, int8_t disp, uint32_t val){
+    this->emit({0x81});                                     // add dword [base + disp], val
+    this->_value_operand(0, base, disp);
+    this->emit_imm32(val);
+}
+
+// a jump that's patched once its target is known, the target is either an instruction, or an exit to the interpreter
+struct JitFixup{
+    size_t pos;
+    size_t target;
+};
+
+// returns the condition a comparison op code tests, with the left value compared to the right, "lt" is inclusive
+static Condition compare_condition(InstructionType op_code){
+    switch (op_code){
+        case InstructionType::INST_NEQ: return COND_NE;
+        case InstructionType::INST_EQ: return COND_E;
+        case InstructionType::INST_GREATER: return COND_G;
+        case InstructionType::INST_GREATER_EQ: return COND_GE;
+        default: return COND_LE;
+    }
+}
+
+// returns the raw bits of a scalar value's data
+static uint32_t value_bits(const Value& val){
+    if (val.get_type() == ValueType::TYPE_FLOAT)
+        return std::bit_cast<uint32_t>(val.get_float());
+    return static_cast<uint32_t>(val.get_int());
+}
+
+/*
+    emits the native template for an instruction, returns false if the instruction doesn't have one. guards that
+    fail jump to the instruction's slow path, which runs it with its helper instead
+*/
+static bool emit_template(CodeBuffer& code, Instruction& inst, Value* vars, std::vector<size_t>& slow_jumps, std::vector<JitFixup>& fixups){
+    const uint32_t string_types {type_mask({ValueType::TYPE_STR, ValueType::TYPE_NAME})};
+    const uint32_t integral_types {type_mask({ValueType::TYPE_INT, ValueType::TYPE_BOOL, ValueType::TYPE_CHAR})};
+    InstructionType op_code = inst.op_code;
+    switch (op_code){
+        case InstructionType::INST_PUSH:{
+            ValueType type = inst.arg.value().get_type();
+            if (type == ValueType::TYPE_STR || type == ValueType::TYPE_NAME || type == ValueType::TYPE_NULL)
+                return false;
+            code.check_room(slow_jumps);
+            code.load_stack_end();
+            code.store_type(REG_RAX, TYPE_OFFSET, type);
+            code.store_imm32(REG_RAX, DATA_OFFSET, value_bits(inst.arg.value()));
+            code.adjust_size(1);
+            return true;
+        }
+        // strings are reference counted, so copying one or overwriting one is left to the helpers
+        case InstructionType::INST_GET:
+            code.load_var(&vars[inst.arg.value().get_int()]);
+            code.check_type_in(REG_RSI, TYPE_OFFSET, string_types | type_mask({ValueType::TYPE_NULL}), false, slow_jumps);
+            code.check_room(slow_jumps);
+            code.load_stack_end();
+            code.copy_value(REG_RAX, 0, REG_RSI, 0);
+            code.adjust_size(1);
+            return true;
+        case InstructionType::INST_SET:
+            code.check_size(1, slow_jumps);
+            code.load_var(&vars[inst.arg.value().get_int()]);
+            code.check_type_in(REG_RSI, TYPE_OFFSET, string_types, false, slow_jumps);
+            code.load_stack_end();
+            code.copy_value(REG_RSI, 0, REG_RAX, -16);
+            code.adjust_size(-1);
+            return true;
+        case InstructionType::INST_POP:
+            code.check_size(1, slow_jumps);
+            code.load_stack_end();
+            code.check_type_in(REG_RAX, TOP_TYPE, string_types, false, slow_jumps);
+            code.adjust_size(-1);
+            return true;
+        case InstructionType::INST_DUP:
+            code.check_size(1, slow_jumps);
+            code.check_room(slow_jumps);
+            code.load_stack_end();
+            code.check_type_in(REG_RAX, TOP_TYPE, string_types, false, slow_jumps);
+            code.copy_value(REG_RAX, 0, REG_RAX, -16);
+            code.adjust_size(1);
+            return true;
+        case InstructionType::INST_ADD:
+        case InstructionType::INST_SUB:
+        case InstructionType::INST_MUL:
+        case InstructionType::INST_NEQ:
+        case InstructionType::INST_EQ:
+        case InstructionType::INST_LESS:
+        case InstructionType::INST_GREATER:
+        case InstructionType::INST_LESS_EQ:
+        case InstructionType::INST_GREATER_EQ:
+        case InstructionType::INST_JUMP_NEQ:
+        case InstructionType::INST_JUMP_EQ:
+        case InstructionType::INST_JUMP_LESS:
+        case InstructionType::INST_JUMP_GREATER:
+        case InstructionType::INST_JUMP_LESS_EQ:
+        case InstructionType::INST_JUMP_GREATER_EQ:
+            // the templates only handle two ints, the right value is loaded into ecx and the left into edx
+            code.check_size(2, slow_jumps);
+            code.load_stack_end();
+            code.check_type(REG_RAX, TOP_TYPE, ValueType::TYPE_INT, slow_jumps);
+            code.check_type(REG_RAX, SECOND_TYPE, ValueType::TYPE_INT, slow_jumps);
+            code.load_int(REG_RCX, REG_RAX, TOP_DATA);
+            if (op_code == InstructionType::INST_ADD)
+                code.int_op(0x01, REG_RAX, SECOND_DATA, REG_RCX);       // add
+            else if (op_code == InstructionType::INST_SUB)
+                code.int_op(0x29, REG_RAX, SECOND_DATA, REG_RCX);       // sub
+            else if (op_code == InstructionType::INST_MUL){
+                code.load_int(REG_RDX, REG_RAX, SECOND_DATA);
+                code.emit({0x0f, 0xaf, 0xd1});                          // imul edx, ecx
+                code.int_op(0x89, REG_RAX, SECOND_DATA, REG_RDX);       // mov
+            }
+            else if (op_code >= InstructionType::INST_JUMP_NEQ){
+                InstructionType compare_op = static_cast<InstructionType>(static_cast<int>(InstructionType::INST_NEQ) + static_cast<int>(op_code) - static_cast<int>(InstructionType::INST_JUMP_NEQ));
+                code.load_int(REG_RDX, REG_RAX, SECOND_DATA);
+                code.adjust_size(-2);
+                code.emit({0x39, 0xca});                                // cmp edx, ecx
+                fixups.push_back({code.emit_jcc(compare_condition(compare_op)), static_cast<size_t>(inst.arg.value().get_int())});
+                return true;
+            }
+            else{
+                code.load_int(REG_RDX, REG_RAX, SECOND_DATA);
+                code.emit({0x39, 0xca});                                // cmp edx, ecx
+                code.emit({0x0f, static_cast<uint8_t>(0x90 | compare_condition(op_code)), 0xc2});   // setcc dl
+                code.emit({0x0f, 0xb6, 0xd2});                          // movzx edx, dl
+                code.store_type(REG_RAX, SECOND_TYPE, ValueType::TYPE_BOOL);
+                code.int_op(0x89, REG_RAX, SECOND_DATA, REG_RDX);       // mov
+            }
+            code.adjust_size(-1);
+            return true;
+        case InstructionType::INST_JUMPIF:
+            code.check_size(1, slow_jumps);
+            code.load_stack_end();
+            code.check_type_in(REG_RAX, TOP_TYPE, integral_types, true, slow_jumps);
+            code.load_int(REG_RCX, REG_RAX, TOP_DATA);
+            code.adjust_size(-1);
+            code.emit({0x85, 0xc9});                                    // test ecx, ecx
+            fixups.push_back({code.emit_jcc(COND_NE), static_cast<size_t>(inst.arg.value().get_int())});
+            return true;
+        case InstructionType::INST_INC_VAR:
+            if (inst.arg.value().get_type() != ValueType::TYPE_INT)
+                return false;
+            code.load_var(&vars[inst.aux]);
+            code.check_type(REG_RSI, TYPE_OFFSET, ValueType::TYPE_INT, slow_jumps);
+            code.add_imm32(REG_RSI, DATA_OFFSET, value_bits(inst.arg.value()));
+            return true;
+        case InstructionType::INST_ADD_IMM:
+            if (inst.arg.value().get_type() != ValueType::TYPE_INT)
+                return false;
+            code.check_size(1, slow_jumps);
+            code.load_stack_end();
+            code.check_type(REG_RAX, TOP_TYPE, ValueType::TYPE_INT, slow_jumps);
+            code.add_imm32(REG_RAX, TOP_DATA, value_bits(inst.arg.value()));
+            return true;
+        default:
+            return false;
+    }
+}
+
+// emits a call to an instruction's helper, and the jumps that handle its result
+static void emit_helper(CodeBuffer& code, Instruction& inst, const JitOp& op, std::vector<size_t>& error_jumps, std::vector<JitFixup>& fixups){
+    code.emit_helper_call(&inst, op.helper);
+    if (op.action == JitAction::JIT_HELPER){
+        error_jumps.push_back(code.emit_jcc(COND_NE));
+        return;
+    }
+    error_jumps.push_back(code.emit_jcc(COND_S));
+    fixups.push_back({code.emit_jcc(COND_NE), static_cast<size_t>(inst.arg.value().get_int())});
+}
+
+// an instruction's slow path, emitted after the region's templates
+struct SlowPath{
+    size_t index;
+    std::vector<size_t> jumps;
+};
+#endif
+
+/*
+    compiles the instructions from start to end (inclusive) into native code, returns nullptr if native code isn't
+    supported. the native code is a function taking the helpers' context, the stack, and the address to start at,
+    the address of each instruction's template is kept so it can be entered at any instruction
+*/
+std::unique_ptr<JitRegion> JitRegion::compile(std::vector<Instruction>& instructions, size_t start, size_t end, const std::vector<JitOp>& ops, Value* vars){
+#ifdef EVO_JIT_X86_64
+    std::unique_ptr<JitRegion> region(new JitRegion());
+    region->_start = start;
+    CodeBuffer code;
+    std::vector<JitFixup> fixups;
+    std::vector<size_t> error_jumps;
+    std::vector<SlowPath> slow_paths;
+    // the context and stack are kept in callee saved registers, the extra 8 bytes keep the stack aligned for calls
+    code.emit({0x53, 0x41, 0x54});              // push rbx; push r12
+    code.emit({0x48, 0x83, 0xec, 0x08});        // sub rsp, 8
+    code.emit({0x48, 0x89, 0xfb});              // mov rbx, rdi
+    code.emit({0x49, 0x89, 0xf4});              // mov r12, rsi
+    code.emit({0xff, 0xe2});                    // jmp rdx
+    for (size_t i = start; i <= end; i++){
+        Instruction& inst = instructions[i];
+        region->_offsets.push_back(static_cast<uint32_t>(code.size()));
+        switch (ops[i].action){
+            case JitAction::JIT_EXIT:
+                code.emit_return(i);
+                break;
+            case JitAction::JIT_JUMP:
+                fixups.push_back({code.emit_jump(), static_cast<size_t>(inst.arg.value().get_int())});
+                break;
+            default:{
+                SlowPath slow_path {i, {}};
+                if (emit_template(code, inst, vars, slow_path.jumps, fixups))
+                    slow_paths.push_back(slow_path);
+                else
+                    emit_helper(code, inst, ops[i], error_jumps, fixups);
+                break;
+            }
+        }
+    }
+    // leaving the end of the loop returns to the interpreter
+    code.emit_return(end + 1);
+    for (const SlowPath& slow_path : slow_paths){
+        for (size_t jump : slow_path.jumps)
+            code.patch_rel32(jump, code.size());
+        emit_helper(code, instructions[slow_path.index], ops[slow_path.index], error_jumps, fixups);
+        fixups.push_back({code.emit_jump(), slow_path.index + 1});
+    }
+    // jumps out of the loop return to the interpreter at their target
+    for (const JitFixup& fixup : fixups){
+        if (fixup.target >= start && fixup.target <= end)
+            code.patch_rel32(fixup.pos, region->_offsets[fixup.target - start]);
+        else{
+            code.patch_rel32(fixup.pos, code.size());
+            code.emit_return(fixup.target);
+        }
+    }
+    for (size_t jump : error_jumps)
+        code.patch_rel32(jump, code.size());
+    code.emit_error_return();
+    // the code is written before it's made executable, so the buffer is never both writable and executable
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    region->_code_size = ((code.size() + page_size - 1) / page_size) * page_size;
+    void* buffer = mmap(nullptr, region->_code_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffer == MAP_FAILED)
+        return nullptr;
+    region->_code = static_cast<uint8_t*>(buffer);
+    std::memcpy(region->_code, code.data(), code.size());
+    if (mprotect(region->_code, region->_code_size, PROT_READ | PROT_EXEC) != 0)
+        return nullptr;
+    return region;
+#else
+    return nullptr;
+#endif
+}
+
+// runs the native code from the given instruction, returns the index of the next instruction for the interpreter to run, or -1 on an error
+long JitRegion::run(void* context, ValueStack& stack, size_t index){
+    typedef long (*NativeCode)(void* context, ValueStack* stack, const uint8_t* entry);
+    NativeCode native = reinterpret_cast<NativeCode>(this->_code);
+    return native(context, &stack, this->_code + this->_offsets[index - this->_start]);
+}
@@ -1,105 +1,27 @@
-#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <algorithm>
 #include <stdexcept>
 #include <format>
 
 #include "../inc/token.hpp"
 #include "../inc/lexer.hpp"
+#include "../inc/keywords.hpp"
 
-// associate each basic keyword with a token
-std::map<std::string, TokenType> token_map = {
-    {"push", TokenType::INST_T},
-    {"->", TokenType::INST_T},
-    {"pop", TokenType::INST_T},
-    {"clear", TokenType::INST_T},
-    {"peek", TokenType::INST_T},
-    {"swap", TokenType::INST_T},
-    {"dup", TokenType::INST_T},
-    {"size", TokenType::INST_T},
-    {"add", TokenType::INST_T},
-    {"+", TokenType::INST_T},
-    {"sub", TokenType::INST_T},
-    {"-", TokenType::INST_T},
-    {"mul", TokenType::INST_T},
-    {"*", TokenType::INST_T},
-    {"div", TokenType::INST_T},
-    {"/", TokenType::INST_T},
-    {"mod", TokenType::INST_T},
-    {"%", TokenType::INST_T},
-    {"and", TokenType::INST_T},
-    {"&", TokenType::INST_T},
-    {"or", TokenType::INST_T},
-    {"|", TokenType::INST_T},
-    {"xor", TokenType::INST_T},
-    {"^", TokenType::INST_T},
-    {"not", TokenType::INST_T},
-    {"!", TokenType::INST_T},
-    {"eq", TokenType::INST_T},
-    {"==", TokenType::INST_T},
-    {"neq", TokenType::INST_T},
-    {"!=", TokenType::INST_T},
-    {"gt", TokenType::INST_T},
-    {">", TokenType::INST_T},
-    {"lt", TokenType::INST_T},
-    {"<", TokenType::INST_T},
-    {"gte", TokenType::INST_T},
-    {">=", TokenType::INST_T},
-    {"lte", TokenType::INST_T},
-    {"<=", TokenType::INST_T},
-    {"j", TokenType::INST_T},
-    {"jif", TokenType::INST_T},
-    {"j==", TokenType::INST_T},
-    {"j!=", TokenType::INST_T},
-    {"j<", TokenType::INST_T},
-    {"j>", TokenType::INST_T},
-    {"j<=", TokenType::INST_T},
-    {"j>=", TokenType::INST_T},
-    {"call", TokenType::INST_T},
-    {"ret", TokenType::INST_T},
-    {"set", TokenType::INST_T},
-    {"<-", TokenType::INST_T},
-    {"get", TokenType::INST_T},
-    {"print", TokenType::INST_T},
-    {"println", TokenType::INST_T},
-    {"print_p", TokenType::INST_T},
-    {"println_p", TokenType::INST_T},
-    {"read", TokenType::INST_T},
-    {"readint", TokenType::INST_T},
-    {"at", TokenType::INST_T},
-    {"len", TokenType::INST_T},
-    {"conv", TokenType::INST_T},
-    {"type", TokenType::INST_T},
-    {"?", TokenType::INST_T},
-    {"TRUE", TokenType::BOOL_T},
-    {"FALSE", TokenType::BOOL_T},
-    {"int", TokenType::TYPE_T},
-    {"float", TokenType::TYPE_T},
-    {"bool", TokenType::TYPE_T},
-    {"char", TokenType::TYPE_T},
-    {"string", TokenType::TYPE_T}
-};
-
-// splits a string by a given delimter character (default space)
-std::vector<std::string> split_str(std::string& str, char delim = ' '){
-    std::vector<std::string> out;
-    size_t delim_pos;
-    std::string tmp;
-    while (true){
-        delim_pos =  str.find(delim);
-        if (delim_pos == str.npos)
-            break;
-        tmp = str.substr(0, delim_pos);
-        str = str.substr(delim_pos + 1);
-        if (tmp.length() > 0)
-            out.push_back(tmp);
-    }
-    // push the last segment (not followed by a space) to the output vector
-    if (str.length() > 0)
-        out.push_back(str);
-    return out;
+// returns the next space separated word of a line, moving pos past it, or an empty word at the end of the line
+static std::string_view next_word(std::string_view line, size_t& pos){
+    while (pos < line.size() && line[pos] == ' ')
+        pos++;
+    size_t start = pos;
+    while (pos < line.size() && line[pos] != ' ')
+        pos++;
+    return line.substr(start, pos - start);
 }
 
 // checks if a string is a number, returns INT_T if the string is an integer, FLOAT_T if the string is a float, and NULL_T if the string is non-numeric
-TokenType num_type(const std::string& str){
+TokenType num_type(std::string_view str){
     bool radix_encountered {false};
     TokenType ret_type {TokenType::INT_T};
     // ensure each character is a digit between 0 and 9, or '.'
@@ -121,19 +43,21 @@ TokenType num_type(const std::string& str){
     return ret_type;
 }
 
-// parses a single line expression, and returns its tokens
-std::vector<Token> tokenize_expr(std::string& expr){
-    std::vector<std::string> words = split_str(expr);
-    std::vector<Token> tokens;
-    std::string word;
-    for (int i = 0; i < words.size(); i++){
-        word = words[i];
+/*
+    tokenizes a single line, appending its tokens to the given vector. every token's text is a slice of the line, so
+    nothing is copied. a string literal runs from a word starting with a quote to the next word ending with one, and
+    its text is everything between the quotes
+*/
+static void tokenize_line(std::string_view line, std::vector<Token>& tokens){
+    size_t pos {0};
+    std::string_view word;
+    while (!(word = next_word(line, pos)).empty()){
         // exit early if we see the comment marker 
         if (word[0] == '#')
-            return tokens;
+            return;
         // check if the word is a predefined token
-        if (token_map.count(word)){
-            tokens.emplace_back(token_map[word], word);
+        if (const Keyword* keyword = find_keyword(word)){
+            tokens.emplace_back(keyword->type, word, keyword);
             continue;
         }
         // check if the word is a numeric literal
@@ -142,31 +66,30 @@ std::vector<Token> tokenize_expr(std::string& expr){
             tokens.emplace_back(str_num, word);
         // check if the word is a string and parse it if so
         else if (word[0] == '"'){
-            // word size checked here to account for the possibility of a string starting with 
-            while (word.back() != '"' || word.size() == 1){
+            size_t start = word.data() - line.data() + 1;
+            // a lone quote opens the string, so the literal continues until a later word ends with a quote
+            bool opening {true};
+            while (word.back() != '"' || (opening && word.size() == 1)){
+                word = next_word(line, pos);
                 // we're at the end of the statement with an unterminated string literal
-                if (word.size() == (i + 1))
+                if (word.empty())
                     throw std::runtime_error("Unterminated string literal");
-                i++;
-                word += " " + words[i];
+                opening = false;
             }
-            // remove quotations
-            word = word.substr(1, word.size() - 2);
-            tokens.emplace_back(TokenType::STR_T, word);
+            size_t end = word.data() - line.data() + word.size() - 1;
+            tokens.emplace_back(TokenType::STR_T, line.substr(start, end - start));
         }
         // check if the word is a charater and parse it if so
         else if (word[0] == '\''){
-            Token tmp(TokenType::CHAR_T, "");
             if (word.size() == 3 && word.back() == '\'')
-                tmp.text.push_back(word[1]);
+                tokens.emplace_back(TokenType::CHAR_T, word.substr(1, 1));
             // check if the character is a space
-            else if (word.size() == 1 &&(i + 1) < words.size() && words[i + 1] == "'"){
-                tmp.text = " ";
-                i++;
+            else if (size_t next = pos; word.size() == 1 && next_word(line, next) == "'"){
+                tokens.emplace_back(TokenType::CHAR_T, std::string_view(" "));
+                pos = next;
             }
             else
                 throw (std::runtime_error("Invalid character literal"));
-            tokens.emplace_back(tmp);
         }
         else if (word.back() == ':'){
             tokens.emplace_back(TokenType::LABEL_T, word.substr(0, word.size() - 1));
@@ -175,21 +98,96 @@ std::vector<Token> tokenize_expr(std::string& expr){
         else
             tokens.emplace_back(TokenType::WORD_T, word);
     }
+}
+
+// parses a single line expression, and returns its tokens, which refer to the expression's text
+std::vector<Token> tokenize_expr(std::string_view expr){
+    std::vector<Token> tokens;
+    tokenize_line(expr, tokens);
     return tokens;
 }
 
-std::vector<std::vector<Token>> tokenize_program(std::stringstream& ss){
-    std::vector<std::vector<Token>> expressions;
-    std::string expr;
-    unsigned int line_no = 1;
-    while (std::getline(ss, expr)){
+/*
+    tokenizes each line of a chunk of source, appending them to the program. returns the number of the line with a
+    syntax error, counting from the start of the chunk, after storing the error, or 0 if every line was tokenized
+*/
+static size_t tokenize_lines(std::string_view chunk, TokenizedProgram& program, std::string& error){
+    size_t line_no {1};
+    size_t line_start {0};
+    while (line_start < chunk.size()){
+        size_t line_end = chunk.find('\n', line_start);
+        if (line_end == chunk.npos)
+            line_end = chunk.size();
         try{
-            expressions.push_back(tokenize_expr(expr));
+            tokenize_line(chunk.substr(line_start, line_end - line_start), program.tokens);
         }
         catch (const std::runtime_error& e){
-            throw std::format("Syntax error on line {}: {}", line_no, e.what());
+            error = e.what();
+            return line_no;
         }
+        program.line_ends.push_back(program.tokens.size());
+        line_start = line_end + 1;
         line_no++;
     }
-    return expressions;
-}
\ No newline at end of file
+    return 0;
+}
+
+/*
+    splits the source at line boundaries into one chunk per thread and tokenizes the chunks in parallel, lines are
+    independent so only the line numbers of errors and the token indexes of line ends depend on earlier chunks
+*/
+static TokenizedProgram tokenize_parallel(std::string_view source, size_t thread_count){
+    std::vector<std::string_view> chunks;
+    size_t chunk_size = source.size() / thread_count;
+    size_t start {0};
+    while (start < source.size()){
+        size_t end = start + chunk_size < source.size() ? source.find('\n', start + chunk_size) : source.npos;
+        end = (end == source.npos) ? source.size() : end + 1;
+        chunks.push_back(source.substr(start, end - start));
+        start = end;
+    }
+    std::vector<TokenizedProgram> results(chunks.size());
+    std::vector<std::string> errors(chunks.size());
+    std::vector<size_t> error_lines(chunks.size());
+    std::vector<std::thread> workers;
+    workers.reserve(chunks.size());
+    for (size_t i = 0; i < chunks.size(); i++)
+        workers.emplace_back([&, i]{
+            // most lines hold a handful of tokens, reserving for them saves regrowing the vector
+            results[i].tokens.reserve(chunks[i].size() / 4);
+            error_lines[i] = tokenize_lines(chunks[i], results[i], errors[i]);
+        });
+    for (std::thread& worker : workers)
+        worker.join();
+    // report the first error in the source, as the sequential lexer would
+    size_t line_offset {0};
+    size_t token_count {0};
+    for (size_t i = 0; i < chunks.size(); i++){
+        if (error_lines[i])
+            throw std::runtime_error(std::format("Syntax error on line {}: {}", line_offset + error_lines[i], errors[i]));
+        line_offset += results[i].line_ends.size();
+        token_count += results[i].tokens.size();
+    }
+    TokenizedProgram program;
+    program.tokens.reserve(token_count);
+    program.line_ends.reserve(line_offset);
+    for (TokenizedProgram& result : results){
+        size_t token_offset = program.tokens.size();
+        program.tokens.insert(program.tokens.end(), result.tokens.begin(), result.tokens.end());
+        for (size_t line_end : result.line_ends)
+            program.line_ends.push_back(token_offset + line_end);
+    }
+    return program;
+}
+
+// tokenizes a whole program in one pass over its source, each line is a single expression. large sources are split between threads
+TokenizedProgram tokenize_program(std::string_view source){
+    size_t thread_count = std::min<size_t>(std::thread::hardware_concurrency(), source.size() / PARALLEL_LEX_CHUNK_SIZE);
+    if (thread_count > 1)
+        return tokenize_parallel(source, thread_count);
+    TokenizedProgram program;
+    std::string error;
+    if (size_t line_no = tokenize_lines(source, program, error))
+        throw std::runtime_error(std::format("Syntax error on line {}: {}", line_no, error));
+    return program;
+}
@@ -1,64 +1,365 @@
 #include <iostream>
-#include <iomanip>
 #include <fstream>
-#include <sstream>
+#include <iomanip>
 #include <stdexcept>
+#include <cctype>
 #include <unordered_map>
 #include <vector>
+#include <memory>
 #include "../inc/interpreter.hpp"
+#include "../inc/source_file.hpp"
+#include "../inc/sampler.hpp"
+#include "../inc/trace.hpp"
 
 enum CommandCode{
     HELP,
     RUN,
     SHELL,
-    VERSION
+    VERSION,
+    COMPILE,
+    TRACE
 };
 
 void print_error(const std::string& message){
     std::cout << "\033[31mError: \033[0m" << message << std::endl;
 }
 
+void print_warning(const std::string& message){
+    std::cout << "\033[33mWarning: \033[0m" << message << std::endl;
+}
+
+// options accepted by the run and compile commands
+struct RunOptions{
+    std::string file_path;
+    std::string output_path;
+    std::string profile_path;   // where to write the profile as JSON, it's printed as a report if this is empty
+    std::string trace_path;
+    std::string stats_path;     // where to write the stats, they're printed to stderr if this is empty
+    ExecEngine engine {ExecEngine::ENGINE_THREADED};
+    bool engine_chosen {false};     // whether the engine was picked on the command line rather than left as the default
+    FlushPolicy flush {default_flush_policy()};
+    FloatFormat float_format {FloatFormat::FLOAT_FIXED};
+    size_t max_stack {DEFAULT_MAX_STACK};
+    bool optimize {false};
+    bool verify {true};
+    bool cache {false};
+    bool profile {false};
+    bool sample {false};
+    bool stats {false};
+};
+
 void print_help(){
     std::vector<std::string> commands {
         "Command:",
         "help",
         "run",
         "shell",
-        "version"
+        "version",
+        "compile",
+        "trace"
     };
     std::vector<std::string> args{
         "Args:",
         "",
-        "<file_name>",
+        "<file_name|-> [options]",
         "",
-        ""
+        "",
+        "<file_name> [options]",
+        "<trace_file> [--dump]"
     };
     std::vector<std::string> descriptions{
         "Description:\n",
         "displays this menu",
-        "executes a .evo source file",
+        "executes a .evo source file, or stdin for -",
         "opens an interactive evo shell",
-        "displays the current program version"
+        "displays the current program version",
+        "compiles a .evo source file to a .evoc bytecode file",
+        "summarizes the jumps and calls in a trace, or prints every instruction in it with --dump"
+    };
+    std::vector<std::string> options{
+        "Run Options:",
+        "--engine=threaded",
+        "--engine=loop",
+        "--engine=register",
+        "--jit",
+        "--max-stack=<n>",
+        "--flush=block",
+        "--flush=line",
+        "--flush=explicit",
+        "--float=fixed",
+        "--float=shortest",
+        "-O",
+        "--no-verify",
+        "--cache",
+        "--profile",
+        "--profile=<path>",
+        "--sample",
+        "--trace=<path>",
+        "--stats",
+        "--stats=<path>",
+        "-o <path>"
     };
-    for (int i = 0; i < 5; i++){
+    std::vector<std::string> option_descriptions{
+        "",
+        "executes with direct threaded dispatch (default)",
+        "executes with the original fetch-and-switch loop",
+        "translates the program to register code before running it",
+        "compiles hot loops to native code (x86-64 Linux only)",
+        "limits the stack to n values (default 65536, at most 268435456)",
+        "writes output in large blocks (default unless stdout is a terminal)",
+        "writes output at the end of every line (default if stdout is a terminal)",
+        "only writes output on the flush instruction, before reading input, and on exit",
+        "prints floats with six decimal places (default)",
+        "prints floats with the fewest digits that read back as the same value",
+        "fuses common instruction sequences into superinstructions",
+        "always runs the checked instruction handlers",
+        "reuses the bytecode compiled by an earlier run of the same source",
+        "prints the hottest op codes, labels and loops to stderr on exit, runs on the loop engine",
+        "writes the profile to path as JSON instead",
+        "samples the running program, and prints its hottest lines to stderr on exit",
+        "writes every instruction run to path, see the trace command, runs on the threaded engine",
+        "prints the instructions run, peak stack and call depth, memory and time as JSON to stderr on exit, runs on the threaded engine",
+        "writes the stats to path instead",
+        "writes the compiled bytecode to path (compile only)"
+    };
+    for (int i = 0; i < commands.size(); i++){
         std::cout << std::setw(12) << std::left << commands[i];
-        std::cout << std::setw(15) << std::left << args[i];
+        std::cout << std::setw(25) << std::left << args[i];
         std::cout << descriptions[i] << std::endl;
     }
+    std::cout << std::endl;
+    for (int i = 0; i < options.size(); i++){
+        std::cout << std::setw(37) << std::left << options[i];
+        std::cout << option_descriptions[i] << std::endl;
+    }
+}
+
+// parses the arguments following the run command, throws an error for unrecognized options
+RunOptions parse_run_options(int argc, char** argv){
+    RunOptions options;
+    std::string arg;
+    for (int i = 2; i < argc; i++){
+        arg = argv[i];
+        if (arg == "--engine=threaded"){
+            options.engine = ExecEngine::ENGINE_THREADED;
+            options.engine_chosen = true;
+        }
+        else if (arg == "--engine=loop"){
+            options.engine = ExecEngine::ENGINE_LOOP;
+            options.engine_chosen = true;
+        }
+        else if (arg == "--engine=register"){
+            options.engine = ExecEngine::ENGINE_REGISTER;
+            options.engine_chosen = true;
+        }
+        else if (arg == "--jit"){
+            options.engine = ExecEngine::ENGINE_JIT;
+            options.engine_chosen = true;
+        }
+        else if (arg == "--flush=block")
+            options.flush = FlushPolicy::FLUSH_BLOCK;
+        else if (arg == "--flush=line")
+            options.flush = FlushPolicy::FLUSH_LINE;
+        else if (arg == "--flush=explicit")
+            options.flush = FlushPolicy::FLUSH_EXPLICIT;
+        else if (arg == "--float=fixed")
+            options.float_format = FloatFormat::FLOAT_FIXED;
+        else if (arg == "--float=shortest")
+            options.float_format = FloatFormat::FLOAT_SHORTEST;
+        else if (arg == "-O")
+            options.optimize = true;
+        else if (arg == "--no-verify")
+            options.verify = false;
+        else if (arg == "--cache")
+            options.cache = true;
+        else if (arg == "--profile")
+            options.profile = true;
+        else if (arg.starts_with("--profile=")){
+            options.profile = true;
+            options.profile_path = arg.substr(10);
+        }
+        else if (arg == "--sample")
+            options.sample = true;
+        else if (arg.starts_with("--trace="))
+            options.trace_path = arg.substr(8);
+        else if (arg == "--stats")
+            options.stats = true;
+        else if (arg.starts_with("--stats=")){
+            options.stats = true;
+            options.stats_path = arg.substr(8);
+        }
+        else if (arg == "-o"){
+            if (++i == argc)
+                throw std::runtime_error("Expected a path after -o");
+            options.output_path = argv[i];
+        }
+        else if (arg.starts_with("--max-stack=")){
+            // stoul would accept a sign and wrap a negative number around to a huge limit, so only digits are allowed
+            std::string value = arg.substr(12);
+            size_t parsed {0};
+            try{
+                if (value.empty() || !std::isdigit(static_cast<unsigned char>(value[0])))
+                    throw std::invalid_argument("not a number");
+                options.max_stack = std::stoul(value, &parsed);
+            }
+            catch (const std::logic_error& e){
+                throw std::runtime_error("Invalid value for --max-stack");
+            }
+            if (parsed != value.size() || options.max_stack > MAX_STACK_LIMIT)
+                throw std::runtime_error("Invalid value for --max-stack");
+        }
+        else if (arg.starts_with("-") && arg != "-")
+            throw std::runtime_error("Unrecognized option \"" + arg + "\", use \"evo help\" for more info");
+        else
+            options.file_path = arg;
+    }
+    if (options.file_path.empty())
+        throw std::runtime_error("No file to run.");
+    if (options.profile && !options.trace_path.empty())
+        throw std::runtime_error("A program can't be profiled and traced in the same run");
+    // profiling runs every instruction on the loop engine, and stats and tracing on the threaded engine, whichever engine is selected
+    if (options.engine_chosen && options.profile && options.engine != ExecEngine::ENGINE_LOOP)
+        throw std::runtime_error("--profile always runs on the loop engine, so it can't be used with another engine");
+    if (options.engine_chosen && !options.profile && (options.stats || !options.trace_path.empty()) && options.engine != ExecEngine::ENGINE_THREADED)
+        throw std::runtime_error("--stats and --trace always run on the threaded engine, so they can't be used with another engine");
+    return options;
+}
+
+// compiles a program, reusing the bytecode in the cache if the same source has been compiled with the same options before
+CompiledProgram cached_compile(Interpreter& machine, std::string_view source, bool optimize){
+    uint64_t hash = hash_source(source, optimize);
+    std::string path = cache_path(hash);
+    if (!path.empty()){
+        try{
+            SourceFile cached(path);
+            CompiledProgram program = load_program(cached.text());
+            if (program.source_hash == hash)
+                return program;
+        }
+        // a missing, stale or corrupt entry is simply compiled again and replaced
+        catch (const std::runtime_error& e){}
+    }
+    CompiledProgram program = machine.compile_prog(source);
+    program.source_hash = hash;
+    if (!path.empty())
+        save_program(program, path);
+    return program;
 }
 
-Value run_from_file(std::string file_path){
-    if (!file_path.ends_with(".evo"))
+// writes a report to a file, or prints it to stderr if the path is empty
+template <typename Writer>
+void write_report(const std::string& path, const std::string& name, Writer writer){
+    if (path.empty()){
+        writer(std::cerr);
+        return;
+    }
+    std::ofstream file(path);
+    writer(file);
+    if (!file.good())
+        throw std::runtime_error("Failed to write the " + name + " to \"" + path + "\"");
+}
+
+// prints or writes the profile, samples, stats and trace of a run
+void write_reports(const Interpreter& machine, Sampler& sampler, TraceWriter* trace, std::string_view source, const RunOptions& options){
+    if (trace != nullptr)
+        trace->close();
+    if (options.sample){
+        sampler.stop();
+        sampler.report(std::cerr, machine.lines(), source);
+    }
+    // a profile printed to stderr is a report, and one written to a file is JSON
+    if (options.profile)
+        write_report(options.profile_path, "profile", [&](std::ostream& out){
+            if (options.profile_path.empty())
+                machine.print_profile(out);
+            else
+                machine.write_profile(out);
+        });
+    if (options.stats)
+        write_report(options.stats_path, "stats", [&](std::ostream& out){machine.write_stats(out);});
+}
+
+Value run_from_file(const RunOptions& options){
+    const std::string& file_path = options.file_path;
+    bool compiled = file_path.ends_with(".evoc");
+    if (file_path != "-" && !compiled && !file_path.ends_with(".evo"))
+        throw std::runtime_error("Invalid source file");
+    Interpreter machine(options.max_stack);
+    machine.set_engine(options.engine);
+    machine.set_optimize(options.optimize);
+    machine.set_verify(options.verify);
+    machine.set_flush_policy(options.flush);
+    machine.set_float_format(options.float_format);
+    machine.set_profile(options.profile);
+    machine.set_stats(options.stats);
+    SourceFile source(file_path);
+    CompiledProgram program;
+    if (compiled)
+        program = load_program(source.text());
+    else if (options.cache)
+        program = cached_compile(machine, source.text(), options.optimize);
+    else
+        program = machine.compile_prog(source.text());
+    if (!options.profile && !options.sample && !options.stats && options.trace_path.empty())
+        return machine.run_compiled(std::move(program));
+    // a compiled program has no source to show alongside its samples
+    std::string_view text = compiled ? std::string_view() : source.text();
+    std::unique_ptr<TraceWriter> trace;
+    if (!options.trace_path.empty()){
+        trace = std::make_unique<TraceWriter>(options.trace_path, program.labels);
+        machine.set_trace(trace.get());
+    }
+    Sampler sampler;
+    if (options.sample)
+        sampler.start(machine, program.instructions.size());
+    // a program that raises an error is still reported on up to the error
+    try{
+        Value result = machine.run_compiled(std::move(program));
+        write_reports(machine, sampler, trace.get(), text, options);
+        return result;
+    }
+    catch (const std::runtime_error& e){
+        write_reports(machine, sampler, trace.get(), text, options);
+        throw;
+    }
+}
+
+void compile_file(const RunOptions& options){
+    const std::string& file_path = options.file_path;
+    if (file_path != "-" && !file_path.ends_with(".evo"))
         throw std::runtime_error("Invalid source file");
+    std::string output_path = options.output_path;
+    if (output_path.empty()){
+        if (file_path == "-")
+            throw std::runtime_error("Use -o to name the output file when compiling from stdin");
+        output_path = file_path + "c";
+    }
     Interpreter machine;
-    std::stringstream buffer;
-    std::ifstream prog_file(file_path);
-    if (!prog_file.good())
-        throw std::runtime_error("Failed to read to program file. Does it exist?");
-    buffer << prog_file.rdbuf();
-    prog_file.close();
-    Value result = machine.run_prog(buffer);
-    return result;
+    machine.set_optimize(options.optimize);
+    SourceFile source(file_path);
+    CompiledProgram program = machine.compile_prog(source.text());
+    program.source_hash = hash_source(source.text(), options.optimize);
+    if (!save_program(program, output_path))
+        throw std::runtime_error("Failed to write the compiled program to \"" + output_path + "\"");
+}
+
+// prints the report of a trace file, or every record in it
+void decode_trace(int argc, char** argv){
+    std::string path;
+    bool dump {false};
+    for (int i = 2; i < argc; i++){
+        std::string arg = argv[i];
+        if (arg == "--dump")
+            dump = true;
+        else if (arg.starts_with("-") && arg != "-")
+            throw std::runtime_error("Unrecognized option \"" + arg + "\", use \"evo help\" for more info");
+        else
+            path = arg;
+    }
+    if (path.empty())
+        throw std::runtime_error("No trace to decode.");
+    SourceFile trace(path);
+    report_trace(std::cout, trace.text(), dump);
 }
 
 void run_shell(){
@@ -66,12 +367,24 @@ void run_shell(){
     std::string input, result;
     while (true){
         std::cout << " > ";
-        std::getline(std::cin, input);
-        if (input == "exit")
+        // the shell also ends when its input does, so it can be driven by another process
+        if (!std::getline(std::cin, input) || input == "exit")
             return;
+        // lines waiting on a label that's never going to be declared would otherwise hold up every line after them
+        if (input == "drop"){
+            machine.discard_pending();
+            continue;
+        }
         try{
             machine.run_expr(input);
-            if (!machine.stack_empty()){
+            std::vector<std::string> pending = machine.pending_labels();
+            if (!pending.empty()){
+                std::string names;
+                for (const std::string& name : pending)
+                    names += (names.empty() ? "\"" : ", \"") + name + "\"";
+                print_warning("waiting for " + names + " to be declared before running, enter \"drop\" to discard the waiting lines");
+            }
+            else if (!machine.stack_empty()){
                 result = machine.stack_top().to_string();
                 std::cout << "   " << result << std::endl;
             }
@@ -83,11 +396,13 @@ void run_shell(){
 }
 
 int main(int argc, char** argv){
+    // programs write their output through the interpreter's own buffer, so the streams don't need to stay in step with stdio
+    std::ios::sync_with_stdio(false);
     if (argc < 2){
         print_error("This program takes at least one argument, use \"evo help\" for more info");
         return 1;
     }
-    std::unordered_map<std::string, CommandCode> command_map = {{"help", HELP}, {"run", RUN}, {"shell", SHELL}, {"version", VERSION}};
+    std::unordered_map<std::string, CommandCode> command_map = {{"help", HELP}, {"run", RUN}, {"shell", SHELL}, {"version", VERSION}, {"compile", COMPILE}, {"trace", TRACE}};
     if (!command_map.count(argv[1])){
         print_error("Unrecognized command, use \"evo help\" for more info");
         return 1;
@@ -102,7 +417,7 @@ int main(int argc, char** argv){
                 return 1;
             }
             try{
-                run_from_file(argv[2]);
+                run_from_file(parse_run_options(argc, argv));
             }
             catch (std::runtime_error e){
                 print_error(e.what());
@@ -111,6 +426,26 @@ int main(int argc, char** argv){
         case SHELL:
             run_shell(); 
             break;
+        case COMPILE:
+            if (argc < 3){
+                print_error("No file to compile.");
+                return 1;
+            }
+            try{
+                compile_file(parse_run_options(argc, argv));
+            }
+            catch (std::runtime_error e){
+                print_error(e.what());
+            }
+            break;
+        case TRACE:
+            try{
+                decode_trace(argc, argv);
+            }
+            catch (std::runtime_error e){
+                print_error(e.what());
+            }
+            break;
         case VERSION:
             std::cout << "EvoLang Version 0.2.1" << std::endl;
             break;
@@ -0,0 +1,66 @@
+#include <string>
+#include <array>
+#include <stdexcept>
+#include "../inc/value.hpp"
+#include "../inc/operations.hpp"
+
+// returns the result of a logical not operation on a value
+bool not_value(const Value& val){
+    if (!val.is_intergral())
+        throw std::runtime_error("invalid type for NOT operation");
+    int data = val.as_int();
+    return (data != 0);
+}
+
+// converts a value of one type to another, the value's type has already been checked
+typedef Value (*Converter)(const Value& val);
+
+static Value int_from_str(const Value& val) {return Value(ValueType::TYPE_INT, std::stoi(val.get_str()));}
+static Value int_from_integral(const Value& val) {return Value(ValueType::TYPE_INT, val.get_int());}
+static Value float_from_int(const Value& val) {return Value(ValueType::TYPE_FLOAT, static_cast<float>(val.get_int()));}
+static Value char_from_str(const Value& val) {return Value(ValueType::TYPE_CHAR, val.get_str()[0]);}
+static Value char_from_integral(const Value& val) {return Value(ValueType::TYPE_CHAR, static_cast<char>(val.get_int()));}
+static Value bool_from_integral(const Value& val) {return Value(ValueType::TYPE_BOOL, val.get_int() != 0);}
+static Value str_from_any(const Value& val) {return Value(ValueType::TYPE_STR, val.to_string());}
+
+// how values are converted to a type
+struct ConversionRule{
+    const char* error {nullptr};    // the error raised for a source type without a converter, if this is null every conversion to the type gives null
+    std::array<Converter, VALUE_TYPE_COUNT> from {};
+};
+
+// builds the conversion matrix, indexed by the target type and then the source type
+consteval std::array<ConversionRule, VALUE_TYPE_COUNT> conversion_rules(){
+    std::array<ConversionRule, VALUE_TYPE_COUNT> rules {};
+    auto rule = [&](ValueType type) -> ConversionRule& {return rules[static_cast<size_t>(type)];};
+    rule(ValueType::TYPE_INT).error = "Cannot convert non-integral type to int";
+    rule(ValueType::TYPE_FLOAT).error = "Can only convert integer values to float";
+    rule(ValueType::TYPE_CHAR).error = "Invalid type for character conversion";
+    rule(ValueType::TYPE_BOOL).error = "Invalid type for boolean conversion";
+    for (size_t i = 0; i < VALUE_TYPE_COUNT; i++){
+        ValueType from = static_cast<ValueType>(i);
+        bool integral = TYPE_TRAITS[i].integral;
+        rule(ValueType::TYPE_INT).from[i] = (from == ValueType::TYPE_STR) ? int_from_str : integral ? int_from_integral : nullptr;
+        rule(ValueType::TYPE_FLOAT).from[i] = (from == ValueType::TYPE_INT) ? float_from_int : nullptr;
+        rule(ValueType::TYPE_CHAR).from[i] = (from == ValueType::TYPE_STR) ? char_from_str : integral ? char_from_integral : nullptr;
+        rule(ValueType::TYPE_BOOL).from[i] = integral ? bool_from_integral : nullptr;
+        rule(ValueType::TYPE_STR).from[i] = str_from_any;
+    }
+    return rules;
+}
+
+constexpr std::array<ConversionRule, VALUE_TYPE_COUNT> CONVERSION_RULES {conversion_rules()};
+
+/*
+    converts a value to the given type. string to int conversions may also raise std::invalid_argument or
+    std::out_of_range, which callers report separately from other conversion errors
+*/
+Value convert_value(const Value& val, ValueType type){
+    const ConversionRule& rule = CONVERSION_RULES[static_cast<size_t>(type)];
+    Converter converter = rule.from[static_cast<size_t>(val.get_type())];
+    if (converter != nullptr)
+        return converter(val);
+    if (rule.error != nullptr)
+        throw std::runtime_error(rule.error);
+    return Value();
+}
@@ -0,0 +1,34 @@
+#include <vector>
+#include <algorithm>
+#include <ostream>
+#include <iostream>
+#include "../inc/output_buffer.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #include <unistd.h>
+#endif
+
+FlushPolicy default_flush_policy(){
+#if defined(__unix__) || defined(__APPLE__)
+    if (isatty(STDOUT_FILENO))
+        return FlushPolicy::FLUSH_LINE;
+#endif
+    return FlushPolicy::FLUSH_BLOCK;
+}
+
+OutputBuffer::OutputBuffer(std::ostream& out, FlushPolicy policy) : _out(&out), _buffer(OUTPUT_BLOCK_SIZE), _policy(policy) {}
+
+void OutputBuffer::_make_room(size_t size){
+    if (this->_policy != FlushPolicy::FLUSH_EXPLICIT)
+        this->flush();
+    if (this->_used + size > this->_buffer.size())
+        this->_buffer.resize(std::max(this->_used + size, 2 * this->_buffer.size()));
+}
+
+void OutputBuffer::flush(){
+    if (this->_used == 0)
+        return;
+    this->_out->write(this->_buffer.data(), this->_used);
+    this->_out->flush();
+    this->_used = 0;
+}
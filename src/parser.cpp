@@ -1,78 +1,28 @@
 #include <string>
 #include <unordered_map>
-#include <algorithm>
 #include <stdexcept>
+#include <algorithm>
 #include <format>
 
 #include "../inc/token.hpp"
+#include "../inc/keywords.hpp"
+#include "../inc/operations.hpp"
 #include "../inc/parser.hpp"
 
 
-// associates each instruction keyword with it's op code
-const std::unordered_map<std::string, InstructionType> inst_map = {
-    {"push", InstructionType::INST_PUSH},
-    {"->", InstructionType::INST_PUSH},
-    {"pop", InstructionType::INST_POP},
-    {"clear", InstructionType::INST_CLEAR},
-    {"dup", InstructionType::INST_DUP},
-    {"peek", InstructionType::INST_PEEK},
-    {"swap", InstructionType::INST_SWAP},
-    {"size", InstructionType::INST_SIZE},
-    {"add", InstructionType::INST_ADD},
-    {"+", InstructionType::INST_ADD},
-    {"sub", InstructionType::INST_SUB},
-    {"-", InstructionType::INST_SUB},
-    {"mul", InstructionType::INST_MUL},
-    {"*", InstructionType::INST_MUL},
-    {"div", InstructionType::INST_DIV},
-    {"/", InstructionType::INST_DIV},
-    {"mod", InstructionType::INST_MOD},
-    {"%", InstructionType::INST_MOD},
-    {"and", InstructionType::INST_AND},
-    {"&", InstructionType::INST_AND},
-    {"or", InstructionType::INST_OR},
-    {"|", InstructionType::INST_OR},
-    {"xor", InstructionType::INST_XOR},
-    {"^", InstructionType::INST_XOR},
-    {"not", InstructionType::INST_NOT},
-    {"!", InstructionType::INST_NOT},
-    {"eq", InstructionType::INST_EQ},
-    {"==", InstructionType::INST_EQ},
-    {"neq", InstructionType::INST_NEQ},
-    {"!=", InstructionType::INST_NEQ},
-    {"lt", InstructionType::INST_LESS},
-    {"<", InstructionType::INST_LESS},
-    {"gt", InstructionType::INST_GREATER},
-    {">", InstructionType::INST_GREATER},
-    {"lte", InstructionType::INST_LESS_EQ},
-    {"<=", InstructionType::INST_LESS_EQ},
-    {"gte", InstructionType::INST_GREATER_EQ},
-    {">=", InstructionType::INST_GREATER_EQ},
-    {"j", InstructionType::INST_JUMP},
-    {"jif", InstructionType::INST_JUMPIF},
-    {"j==", InstructionType::INST_JUMPIF},
-    {"j!=", InstructionType::INST_JUMPIF},
-    {"j<", InstructionType::INST_JUMPIF},
-    {"j>", InstructionType::INST_JUMPIF},
-    {"j<=", InstructionType::INST_JUMPIF},
-    {"j>=", InstructionType::INST_JUMPIF},
-    {"call", InstructionType::INST_CALL},
-    {"ret", InstructionType::INST_RET},
-    {"set", InstructionType::INST_SET},
-    {"<-", InstructionType::INST_SET},
-    {"get", InstructionType::INST_GET},
-    {"print", InstructionType::INST_PRINT},
-    {"println", InstructionType::INST_PRINTLN},
-    {"print_p", InstructionType::INST_PRINT},
-    {"println_p", InstructionType::INST_PRINTLN},
-    {"read", InstructionType::INST_READ},
-    {"readint", InstructionType::INST_READINT},
-    {"at", InstructionType::INST_AT},
-    {"len", InstructionType::INST_LEN},
-    {"type", InstructionType::INST_TYPE},
-    {"conv", InstructionType::INST_CONVERT},
-    {"?", InstructionType::INST_COND}
-};
+// a ret with an empty call stack resumes at the second instruction, so it's a jump target in every program
+const size_t EMPTY_RET_ADDR {1};
+
+// replaces each run of spaces in a string with a single space
+static std::string collapse_spaces(std::string_view str){
+    std::string collapsed;
+    collapsed.reserve(str.size());
+    for (size_t i = 0; i < str.size(); i++){
+        if (str[i] != ' ' || i == 0 || str[i - 1] != ' ')
+            collapsed.push_back(str[i]);
+    }
+    return collapsed;
+}
 
 // parses a literal expression, evaluates the value and creates a push instruction for it 
 void Parser::_parse_literal(const Token& token){
@@ -82,11 +32,11 @@ void Parser::_parse_literal(const Token& token){
     float float_val;
     switch (token.type){
         case TokenType::INT_T:
-            int_val = std::stoi(token.text);
+            int_val = std::stoi(std::string(token.text));
             val = Value(ValueType::TYPE_INT, int_val);
             break;
         case TokenType::FLOAT_T:
-            float_val = std::stof(token.text);
+            float_val = std::stof(std::string(token.text));
             val = Value(ValueType::TYPE_FLOAT, float_val);
             break;
         case TokenType::BOOL_T:
@@ -97,45 +47,73 @@ void Parser::_parse_literal(const Token& token){
             val = Value(ValueType::TYPE_CHAR, token.text[0]);
             break;
         case TokenType::STR_T:
-            val = Value(ValueType::TYPE_STR, token.text);
+            // the lexer has always read string literals word by word, so runs of spaces in them are a single space
+            if (token.text.find("  ") == token.text.npos)
+                val = Value(ValueType::TYPE_STR, token.text);
+            else
+                val = Value(ValueType::TYPE_STR, collapse_spaces(token.text));
             break;
     }
     this->_instructions.emplace_back(InstructionType::INST_PUSH, val);
-    this->_inst_no++;
+}
+
+// returns the slot assigned to a declared variable, or -1 if the variable is undeclared
+int Parser::_var_slot(std::string_view name){
+    auto slot = this->_var_slots.find(name);
+    if (slot == this->_var_slots.end())
+        return -1;
+    return slot->second;
+}
+
+// returns the slot assigned to a variable, assigning the next free slot if it has not been declared yet
+int Parser::_declare_var(std::string_view name){
+    auto slot = this->_var_slots.find(name);
+    if (slot != this->_var_slots.end())
+        return slot->second;
+    int new_slot = static_cast<int>(this->_var_names.size());
+    this->_var_names.emplace_back(name);
+    this->_var_slots.emplace(this->_var_names.back(), new_slot);
+    return new_slot;
+}
+
+// declares each of the given variables, in order, used when loading a program that was parsed earlier
+void Parser::declare_vars(const std::vector<std::string>& names){
+    for (const std::string& name : names)
+        this->_declare_var(name);
 }
 
 // parses a non-keyword name, checking the next token to determine how to handle it
 void Parser::_parse_word(const Token& token){
+    std::string_view next = this->_tokens.empty() ? "" : this->_tokens.back().text;
     // the next instruction is "set" and needs only the variable name
-    if (!this->_tokens.empty() && this->_tokens.back().text == "set" || this->_tokens.back().text == "<-"){
-        this->_word_stack.push_back(token.text);
+    if (next == "set" || next == "<-"){
+        this->_word_stack.emplace_back(token.text);
     }
     // the next instruction is get and we need to determine if the variable is known to exist
-    else if (!this->_tokens.empty() && this->_tokens.back().text == "get"  || this->_tokens.back().text == "->"){
+    else if (next == "get" || next == "->"){
         // ensure the variable has been declared
-        if (std::find(this->_vars.begin(), this->_vars.end(), token.text) == this->_vars.end())
+        if (this->_var_slot(token.text) == -1)
             throw std::runtime_error(std::format("Error on line {}: use of undeclared varaible \"{}\"" , this->_line_no, token.text));
-        this->_word_stack.push_back(token.text);
+        this->_word_stack.emplace_back(token.text);
     }
     // the next token is unknown, and we assume this is an implicit get if its a variable, otherwise, we assume that it's a label
     else{
         // parse the word as a variable if declared
-        if (std::find(this->_vars.begin(), this->_vars.end(), token.text) != this->_vars.end()){
-            Value name_val(ValueType::TYPE_NAME, token.text);
-            this->_instructions.emplace_back(InstructionType::INST_GET, name_val);
-            this->_inst_no++;
-        }
+        int slot = this->_var_slot(token.text);
+        if (slot != -1)
+            this->_instructions.emplace_back(InstructionType::INST_GET, Value(ValueType::TYPE_INT, slot));
         // parse the word as a label (simply push it to the word stack)
         else
-            this->_word_stack.push_back(token.text);
+            this->_word_stack.emplace_back(token.text);
     }
 }
 
 // parses a named instruction
 void Parser::_parse_inst(const Token& token){
-    InstructionType op_code = inst_map.at(token.text);
+    InstructionType op_code = token.keyword->op_code;
     Value arg_val;
-    std::string var_name, label_name, condtion;
+    std::string var_name, label_name;
+    int slot;
     switch (op_code){
         case InstructionType::INST_PUSH:
             // at the moment, the explicit PUSH command is only sugar, so we can ignore it, as values are already implicitly pushed
@@ -147,23 +125,20 @@ void Parser::_parse_inst(const Token& token){
             var_name = this->_word_stack.back();
             this->_word_stack.pop_back(); 
             // ensure the variable has been decleared
-            if (std::find(this->_vars.begin(), this->_vars.end(), token.text) == this->_vars.end())
-                throw std::runtime_error(std::format("Error on line {}: use of undeclared varaible \"{}\"" , this->_line_no, token.text));
-            arg_val = Value(ValueType::TYPE_NAME, var_name);
+            slot = this->_var_slot(var_name);
+            if (slot == -1)
+                throw std::runtime_error(std::format("Error on line {}: use of undeclared varaible \"{}\"" , this->_line_no, var_name));
+            arg_val = Value(ValueType::TYPE_INT, slot);
             this->_instructions.emplace_back(op_code, arg_val);
-            this->_inst_no++;
             break;
         case InstructionType::INST_SET:
             if (_word_stack.empty())
                 throw std::runtime_error(std::format("Error on line {}: expected an identifier" , this->_line_no));
             var_name = this->_word_stack.back();
             this->_word_stack.pop_back(); 
-            arg_val = Value(ValueType::TYPE_NAME, var_name);
+            // declare the variable if it has not already been declared, and store to its slot
+            arg_val = Value(ValueType::TYPE_INT, this->_declare_var(var_name));
             this->_instructions.emplace_back(InstructionType::INST_SET, arg_val);
-            this->_inst_no++;
-            // add the variable name to the list of declared variables if not already decleared
-            if (std::find(this->_vars.begin(), this->_vars.end(), token.text) == this->_vars.end())
-                this->_vars.push_back(var_name);
             break;
         case InstructionType::INST_JUMP:
         case InstructionType::INST_JUMPIF:
@@ -172,34 +147,28 @@ void Parser::_parse_inst(const Token& token){
                 throw std::runtime_error(std::format("Error on line {}: Jump statement must have label", this->_line_no));
             label_name = this->_word_stack.back();
             this->_word_stack.pop_back();
-            // check if the label is already defined, and assign the direct instruction number if so
-            if (this->_labels.count(token.text))
-                arg_val = Value(ValueType::TYPE_INT, this->_labels[label_name]);
-            else
-                arg_val = Value(ValueType::TYPE_STR, label_name);
             // if this is a JIF instruction, check if it's a compound operation
-
-            if (op_code == InstructionType::INST_JUMPIF && token.text != "jif"){
-                condtion = token.text.substr(1);
-                this->_instructions.emplace_back(inst_map.at(condtion));
+            if (token.keyword->condition != InstructionType::INST_NULL)
+                this->_emit_op(token.keyword->condition);
+            // check if the label is already defined, and assign the direct instruction number if so, otherwise the jump is resolved once every label is known
+            if (auto label = this->_labels.find(label_name); label != this->_labels.end())
+                arg_val = Value(ValueType::TYPE_INT, label->second);
+            else{
+                arg_val = Value(ValueType::TYPE_STR, label_name);
+                this->_jump_indexes.push_back(this->_instructions.size());
             }
             this->_instructions.emplace_back(op_code, arg_val);
-            this->_inst_no++;
             break;
         case InstructionType::INST_PRINT:
         case InstructionType::INST_PRINTLN:
             this->_instructions.emplace_back(op_code);
-            this->_inst_no++;
             // check if this is a print and pop command
-            if (token.text.ends_with("_p")){
+            if (token.text.ends_with("_p"))
                 this->_instructions.emplace_back(InstructionType::INST_POP);
-                this->_inst_no++;
-            }
             break;
         default:
             // the instruction is a "simple" instruction which takes no argument
-            this->_instructions.emplace_back(op_code);
-            this->_inst_no++;
+            this->_emit_op(op_code);
             break;
 
     }
@@ -207,34 +176,110 @@ void Parser::_parse_inst(const Token& token){
 
 // parses a label
 void Parser::_parse_label(const Token& token){
-    if (this->_labels.count(token.text))
+    if (this->_labels.contains(token.text))
         throw std::runtime_error(std::format("Error on line {}: redeclaration of label \"{}\"" , this->_line_no, token.text));
-    this->_labels[token.text] = this->_inst_no;
+    this->_labels.emplace(token.text, this->_instructions.size());
+    this->_label_order.emplace_back(token.text);
+    // the instructions before a label can no longer be folded into the instructions after it
+    this->_fold_barrier = this->_instructions.size();
+}
+
+// emits an instruction that takes no argument, folding it into a single push if all of its operands are literals
+void Parser::_emit_op(InstructionType op_code){
+    if (!this->_fold(op_code))
+        this->_instructions.emplace_back(op_code);
+}
+
+/*
+    tries to evaluate an operation on the literal pushes at the end of the instruction list at parse time, replacing them with
+    a push of the result. returns false, leaving the instructions unchanged, if the operands aren't all literals or if the
+    operation fails, so that the error is raised at runtime with the same line number and message as unfolded code
+*/
+bool Parser::_fold(InstructionType op_code){
+    size_t operands {2};
+    switch (op_code){
+        case InstructionType::INST_NOT:
+            operands = 1;
+            break;
+        case InstructionType::INST_ADD:
+        case InstructionType::INST_SUB:
+        case InstructionType::INST_MUL:
+        case InstructionType::INST_DIV:
+        case InstructionType::INST_MOD:
+        case InstructionType::INST_AND:
+        case InstructionType::INST_OR:
+        case InstructionType::INST_XOR:
+        case InstructionType::INST_NEQ:
+        case InstructionType::INST_EQ:
+        case InstructionType::INST_LESS:
+        case InstructionType::INST_GREATER:
+        case InstructionType::INST_LESS_EQ:
+        case InstructionType::INST_GREATER_EQ:
+        case InstructionType::INST_CONVERT:
+            break;
+        default:
+            return false;
+    }
+    size_t size = this->_instructions.size();
+    // a label may point at the first operand, but not at any later instruction of the folded sequence, and neither may
+    // the address a ret returns to when the call stack is empty, which _jump_targets marks for the peephole pass
+    size_t barrier = std::max(this->_fold_barrier, EMPTY_RET_ADDR);
+    if (size < operands || size - operands < barrier)
+        return false;
+    for (size_t i = size - operands; i < size; i++)
+        if (this->_instructions[i].op_code != InstructionType::INST_PUSH)
+            return false;
+    Value result = this->_instructions[size - operands].arg.value();
+    const Value& right_val = this->_instructions[size - 1].arg.value();
+    try{
+        switch (op_code){
+            case InstructionType::INST_NOT: result = Value(ValueType::TYPE_BOOL, not_value(result)); break;
+            case InstructionType::INST_ADD: arith_values<InstructionType::INST_ADD>(result, right_val); break;
+            case InstructionType::INST_SUB: arith_values<InstructionType::INST_SUB>(result, right_val); break;
+            case InstructionType::INST_MUL: arith_values<InstructionType::INST_MUL>(result, right_val); break;
+            case InstructionType::INST_DIV: arith_values<InstructionType::INST_DIV>(result, right_val); break;
+            case InstructionType::INST_MOD: arith_values<InstructionType::INST_MOD>(result, right_val); break;
+            case InstructionType::INST_AND: logic_values<InstructionType::INST_AND>(result, right_val); break;
+            case InstructionType::INST_OR: logic_values<InstructionType::INST_OR>(result, right_val); break;
+            case InstructionType::INST_XOR: logic_values<InstructionType::INST_XOR>(result, right_val); break;
+            case InstructionType::INST_NEQ: result = Value(ValueType::TYPE_BOOL, compare_values<InstructionType::INST_NEQ>(result, right_val)); break;
+            case InstructionType::INST_EQ: result = Value(ValueType::TYPE_BOOL, compare_values<InstructionType::INST_EQ>(result, right_val)); break;
+            case InstructionType::INST_LESS: result = Value(ValueType::TYPE_BOOL, compare_values<InstructionType::INST_LESS>(result, right_val)); break;
+            case InstructionType::INST_GREATER: result = Value(ValueType::TYPE_BOOL, compare_values<InstructionType::INST_GREATER>(result, right_val)); break;
+            case InstructionType::INST_LESS_EQ: result = Value(ValueType::TYPE_BOOL, compare_values<InstructionType::INST_LESS_EQ>(result, right_val)); break;
+            case InstructionType::INST_GREATER_EQ: result = Value(ValueType::TYPE_BOOL, compare_values<InstructionType::INST_GREATER_EQ>(result, right_val)); break;
+            case InstructionType::INST_CONVERT:
+                if (right_val.get_type() != ValueType::TYPE_VALTYPE)
+                    return false;
+                result = convert_value(result, static_cast<ValueType>(right_val.get_int()));
+                break;
+        }
+    }
+    catch (const std::exception& e){
+        return false;
+    }
+    this->_instructions.resize(size - operands);
+    this->_instructions.emplace_back(InstructionType::INST_PUSH, result);
+    // the operands may have come from earlier lines, but the folded push belongs to this one
+    while (!this->_lines.empty() && this->_lines.back().address >= size - operands)
+        this->_lines.pop_back();
+    this->_lines.push_back({static_cast<uint32_t>(size - operands), static_cast<uint32_t>(this->_line_no)});
+    return true;
 }
 
 // parses a value type
 void Parser::_parse_type(const Token& token){
-    std::unordered_map<std::string, ValueType> type_map{
-        {"int", ValueType::TYPE_INT},
-        {"float", ValueType::TYPE_FLOAT},
-        {"bool", ValueType::TYPE_BOOL},
-        {"char", ValueType::TYPE_CHAR},
-        {"string", ValueType::TYPE_STR}
-    };
-    Value val = Value(ValueType::TYPE_VALTYPE, static_cast<int>(type_map[token.text]));
+    Value val = Value(ValueType::TYPE_VALTYPE, static_cast<int>(token.keyword->value_type));
     this->_instructions.emplace_back(InstructionType::INST_PUSH, val);
-    this->_inst_no++;
 }
 
-// parses the instructions for a single expression in reverse ordeer
-std::vector<Instruction> Parser::parse_expr(bool clear){
-    if (clear)
-        this->_instructions.clear();
+// parses the instructions for a single expression in reverse ordeer, appending them to the instructions parsed so far
+void Parser::_parse_tokens(){
     this->_line_no++;
-    Token token{TokenType::NULL_T, ""};
+    this->_mark_line();
     while (!this->_tokens.empty()){
-        token = this->_tokens.back();
-        this->_tokens.pop_back();
+        const Token& token = this->_tokens.back();
+        this->_tokens = this->_tokens.first(this->_tokens.size() - 1);
         switch (token.type){
             case TokenType::INT_T:
             case TokenType::FLOAT_T:
@@ -257,53 +302,246 @@ std::vector<Instruction> Parser::parse_expr(bool clear){
                 break;
         }
     }
-    return this->_instructions;
 }
 
-// parses a program, each token vector represents a single expression
-std::vector<Instruction> Parser::parse_program(std::vector<std::vector<Token>>& statements){
-    for (std::vector<Token>& statement : statements){
-        this->_tokens = statement;
-        this->parse_expr();
+// starts a line table entry for the line about to be parsed, replacing the previous line's entry if it had no instructions
+void Parser::_mark_line(){
+    uint32_t address = this->_instructions.size();
+    if (!this->_lines.empty() && this->_lines.back().address == address)
+        this->_lines.back().line = this->_line_no;
+    else
+        this->_lines.push_back({address, static_cast<uint32_t>(this->_line_no)});
+}
+
+// points every jump parsed before its label was declared at the label. jumps whose labels still haven't been declared are an error if require_all is set, otherwise they're kept until their labels are declared, returns true if every jump was resolved
+bool Parser::_resolve_labels(bool require_all){
+    size_t pending {0};
+    for (size_t index : this->_jump_indexes){
+        Instruction& jump = this->_instructions[index];
+        auto label = this->_labels.find(jump.arg.value().get_str());
+        if (label != this->_labels.end())
+            jump.set_arg(Value(ValueType::TYPE_INT, label->second));
+        else if (require_all)
+            throw std::runtime_error(std::format("Error: use of undeclared label"));
+        else
+            this->_jump_indexes[pending++] = index;
+    }
+    this->_jump_indexes.resize(pending);
+    return pending == 0;
+}
+
+/*
+    parses a single expression onto the end of code, which must hold every expression parsed since the parser was
+    last reset. labels and variables declared by earlier expressions stay declared, and jumps to labels that haven't
+    been declared yet are resolved once they are. returns true if every jump parsed so far has been resolved. if the
+    expression can't be parsed, code is left as it was
+*/
+bool Parser::parse_append(std::span<const Token> tokens, std::vector<Instruction>& code){
+    size_t start = code.size();
+    // everything this expression declares is forgotten again if it can't be parsed
+    ParserMark before = this->mark(code);
+    std::swap(this->_instructions, code);
+    // earlier expressions may have already run, so their instructions can't be folded into this one's
+    this->_fold_barrier = start;
+    this->_tokens = tokens;
+    try{
+        this->_parse_tokens();
+    }
+    catch (...){
+        this->_tokens = {};
+        std::swap(this->_instructions, code);
+        this->rollback(before, code);
+        throw;
+    }
+    bool resolved = this->_resolve_labels(false);
+    std::swap(this->_instructions, code);
+    return resolved;
+}
+
+// returns how much has been parsed onto code and declared so far
+ParserMark Parser::mark(const std::vector<Instruction>& code) const{
+    return {code.size(), this->_var_names.size(), this->_label_order.size()};
+}
+
+// discards every instruction parsed onto code since the mark, along with the labels, variables and jumps they declared
+void Parser::rollback(const ParserMark& mark, std::vector<Instruction>& code){
+    code.resize(mark.instructions);
+    for (size_t i = mark.labels; i < this->_label_order.size(); i++)
+        if (auto entry = this->_labels.find(this->_label_order[i]); entry != this->_labels.end())
+            this->_labels.erase(entry);
+    this->_label_order.resize(mark.labels);
+    for (size_t i = mark.vars; i < this->_var_names.size(); i++)
+        if (auto slot = this->_var_slots.find(this->_var_names[i]); slot != this->_var_slots.end())
+            this->_var_slots.erase(slot);
+    this->_var_names.resize(mark.vars);
+    size_t start = mark.instructions;
+    std::erase_if(this->_jump_indexes, [start](size_t index){return index >= start;});
+    std::erase_if(this->_lines, [start](const LineEntry& entry){return entry.address >= start;});
+}
+
+// returns the labels that the jumps parsed onto code are still waiting on, in the order they were first jumped to
+std::vector<std::string> Parser::pending_labels(const std::vector<Instruction>& code) const{
+    std::vector<std::string> names;
+    for (size_t index : this->_jump_indexes){
+        std::string name {code[index].arg.value().get_str()};
+        if (std::find(names.begin(), names.end(), name) == names.end())
+            names.push_back(std::move(name));
     }
-    // read through all instructions to find if there are any jumps with unresolved labels, and resolve them if so
-    // TODO: Find a more efficient way to do this
-    Value label_no;
-    std::string label_str;
-    for (int i = 0; i < this->_instructions.size(); i++){
-        if (this->_instructions[i].op_code == InstructionType::INST_JUMP || this->_instructions[i].op_code == InstructionType::INST_CALL || this->_instructions[i].op_code == InstructionType::INST_JUMPIF)
-            if (this->_instructions[i].arg.value().get_type() == ValueType::TYPE_STR){
-                label_str = std::get<std::string>(this->_instructions[i].arg.value().get_value());
-                if (!this->_labels.count(label_str))
-                    throw std::runtime_error(std::format("Error: use of undeclared label"));
-                label_no = Value(ValueType::TYPE_INT, this->_labels[label_str]);
-                this->_instructions[i].set_arg(label_no);
+    return names;
+}
+
+// parses a program, each line of tokens represents a single expression. the parsed instructions are moved out of the parser
+std::vector<Instruction> Parser::parse_program(const TokenizedProgram& program){
+    this->_instructions.reserve(program.tokens.size());
+    size_t line_start {0};
+    for (size_t line_end : program.line_ends){
+        this->_tokens = std::span<const Token>(program.tokens).subspan(line_start, line_end - line_start);
+        this->_parse_tokens();
+        line_start = line_end;
+    }
+    this->_resolve_labels(true);
+    if (this->_optimize)
+        this->_peephole();
+    return std::move(this->_instructions);
+}
+
+/*
+    tries to fuse the instructions starting at the given index into a single superinstruction, appending the result to out.
+    returns the number of instructions consumed, which is 1 if nothing could be fused. no instruction after the first in a
+    fused sequence may be a jump target, as there would be nothing left to jump to
+*/
+size_t Parser::_fuse(size_t index, const std::vector<bool>& is_target, std::vector<Instruction>& out){
+    const std::vector<Instruction>& code = this->_instructions;
+    // returns true if the next n instructions exist and none of them (except the first) are jump targets
+    auto fusable = [&](size_t n){
+        if (index + n > code.size())
+            return false;
+        for (size_t i = index + 1; i < index + n; i++)
+            if (is_target[i])
+                return false;
+        return true;
+    };
+    const Instruction& first = code[index];
+    // a variable incremented by a literal, pushed in either order: "set x add x k" or "set x add k x"
+    if (fusable(4) && code[index + 2].op_code == InstructionType::INST_ADD && code[index + 3].op_code == InstructionType::INST_SET){
+        const Instruction& second = code[index + 1];
+        int slot = code[index + 3].arg.value().get_int();
+        if (first.op_code == InstructionType::INST_PUSH && second.op_code == InstructionType::INST_GET && second.arg.value().get_int() == slot){
+            out.emplace_back(InstructionType::INST_INC_VAR, first.arg.value(), slot);
+            return 4;
+        }
+        if (first.op_code == InstructionType::INST_GET && second.op_code == InstructionType::INST_PUSH && first.arg.value().get_int() == slot){
+            out.emplace_back(InstructionType::INST_INC_VAR, second.arg.value(), slot);
+            return 4;
+        }
+    }
+    if (!fusable(2)){
+        out.push_back(first);
+        return 1;
+    }
+    const Instruction& second = code[index + 1];
+    switch (first.op_code){
+        // a comparison followed by a conditional jump
+        case InstructionType::INST_NEQ:
+        case InstructionType::INST_EQ:
+        case InstructionType::INST_LESS:
+        case InstructionType::INST_GREATER:
+        case InstructionType::INST_LESS_EQ:
+        case InstructionType::INST_GREATER_EQ:
+            if (second.op_code == InstructionType::INST_JUMPIF){
+                // the fused jumps are in the same order as the comparisons
+                int offset = static_cast<int>(first.op_code) - static_cast<int>(InstructionType::INST_NEQ);
+                out.emplace_back(static_cast<InstructionType>(static_cast<int>(InstructionType::INST_JUMP_NEQ) + offset), second.arg.value());
+                return 2;
+            }
+            break;
+        // a literal immediately added to the top of the stack
+        case InstructionType::INST_PUSH:
+            if (second.op_code == InstructionType::INST_ADD){
+                out.emplace_back(InstructionType::INST_ADD_IMM, first.arg.value());
+                return 2;
+            }
+            break;
+        // print_p and println_p
+        case InstructionType::INST_PRINT:
+        case InstructionType::INST_PRINTLN:
+            if (second.op_code == InstructionType::INST_POP){
+                out.emplace_back(first.op_code == InstructionType::INST_PRINT ? InstructionType::INST_PRINT_POP : InstructionType::INST_PRINTLN_POP);
+                return 2;
             }
+            break;
     }
-    return this->_instructions;
+    out.push_back(first);
+    return 1;
 }
 
-// resets the parser's state entirely
-void Parser::reset(){
-    this->_line_no = 0;
-    this->_inst_no = 0;
-    this->_vars.clear();
-    this->_word_stack.clear();
-    this->_instructions.clear();
-    this->_tokens.clear();
+// returns whether each address, up to and including the one past the last instruction, can be jumped or returned to
+std::vector<bool> Parser::_jump_targets() const{
+    size_t count = this->_instructions.size();
+    std::vector<bool> is_target(count + 1, false);
+    for (auto& [label, addr] : this->_labels)
+        is_target[addr] = true;
+    if (count > EMPTY_RET_ADDR)
+        is_target[EMPTY_RET_ADDR] = true;
+    return is_target;
 }
 
-// resets the parser's state, and sets its tokens to the provided vector
-void Parser::reset(const std::vector<Token>& tokens){
+// rewrites common instruction sequences into superinstructions, and updates every jump and label to the new addresses
+void Parser::_peephole(){
+    size_t count = this->_instructions.size();
+    std::vector<bool> is_target = this->_jump_targets();
+    std::vector<Instruction> optimized;
+    optimized.reserve(count);
+    // maps each original address to its new address, including the address one past the end
+    std::vector<int> new_addrs(count + 1);
+    size_t consumed;
+    for (size_t i = 0; i < count; i += consumed){
+        new_addrs[i] = optimized.size();
+        consumed = this->_fuse(i, is_target, optimized);
+        // nothing jumps into a fused sequence, but a line can start inside one, and its own instructions then start after it
+        for (size_t j = i + 1; j < i + consumed; j++)
+            new_addrs[j] = new_addrs[i] + 1;
+    }
+    new_addrs[count] = optimized.size();
+    for (Instruction& inst : optimized)
+        if (is_jump(inst.op_code))
+            inst.set_arg(Value(ValueType::TYPE_INT, new_addrs[inst.arg.value().get_int()]));
+    for (auto& [label, addr] : this->_labels)
+        addr = new_addrs[addr];
+    // a line whose instructions were all fused into another line's loses its entry
+    std::vector<LineEntry> lines;
+    for (const LineEntry& entry : this->_lines){
+        uint32_t address = new_addrs[entry.address];
+        if (!lines.empty() && lines.back().address == address)
+            lines.back().line = entry.line;
+        else
+            lines.push_back({address, entry.line});
+    }
+    this->_lines = std::move(lines);
+    this->_instructions = std::move(optimized);
+}
+
+// returns every declared label, sorted by the address it marks
+std::vector<ProgramLabel> Parser::labels() const{
+    std::vector<ProgramLabel> labels;
+    labels.reserve(this->_labels.size());
+    for (const auto& [name, addr] : this->_labels)
+        labels.push_back({name, static_cast<size_t>(addr)});
+    std::sort(labels.begin(), labels.end(), [](const ProgramLabel& a, const ProgramLabel& b){return a.address < b.address;});
+    return labels;
+}
+
+// resets the parser's state entirely
+void Parser::reset(){
     this->_line_no = 0;
-    this->_inst_no = 0;
-    this->_vars.clear();
+    this->_fold_barrier = 0;
+    this->_var_slots.clear();
+    this->_var_names.clear();
+    this->_labels.clear();
+    this->_label_order.clear();
+    this->_jump_indexes.clear();
+    this->_lines.clear();
     this->_word_stack.clear();
     this->_instructions.clear();
-    this->_tokens = tokens;
-}
-
-// sets the parser's tokens without otherwise changing the state
-void Parser::set_tokens(const std::vector<Token>& tokens){
-    this->_tokens = tokens;
+    this->_tokens = {};
 }
@@ -0,0 +1,151 @@
+#include <vector>
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <format>
+#include <algorithm>
+#include "../inc/instruction.hpp"
+#include "../inc/profiler.hpp"
+
+// the most labels and loops shown by a report, every one is written to JSON
+const size_t REPORT_LIMIT {20};
+// the name given to the code before the first label
+const std::string_view TOP_LEVEL {"(top level)"};
+
+// an op code, label or loop, with the instructions run in it and their time
+struct ProfileEntry{
+    std::string_view name;
+    size_t address {0};     // the address of a label, or of a loop's backward jump
+    size_t target {0};      // the address a loop jumps back to
+    uint64_t count {0};
+    uint64_t cycles {0};
+};
+
+struct ProfileSummary{
+    uint64_t count {0};
+    uint64_t cycles {0};
+    std::vector<ProfileEntry> op_codes;
+    std::vector<ProfileEntry> labels;
+    std::vector<ProfileEntry> loops;
+};
+
+void Profiler::resize(size_t inst_count){
+    if (inst_count <= this->_counts.size())
+        return;
+    this->_counts.resize(inst_count);
+    this->_cycles.resize(inst_count);
+    this->_back_jumps.resize(inst_count);
+}
+
+void Profiler::clear(){
+    this->_counts.clear();
+    this->_cycles.clear();
+    this->_back_jumps.clear();
+}
+
+// returns the name of the label an address falls under, the labels must be sorted by address
+static std::string_view label_name(const std::vector<ProgramLabel>& labels, size_t address){
+    const ProgramLabel* label = label_of(labels, address);
+    return label ? std::string_view(label->name) : TOP_LEVEL;
+}
+
+// groups what was recorded for each instruction by op code, label and loop, each sorted hottest first
+static ProfileSummary summarize(const std::vector<uint64_t>& counts, const std::vector<uint64_t>& cycles, const std::vector<uint64_t>& back_jumps,
+                                const std::vector<Instruction>& instructions, const std::vector<ProgramLabel>& labels){
+    ProfileSummary summary;
+    std::vector<ProfileEntry> op_codes(static_cast<size_t>(InstructionType::INST_COUNT));
+    for (size_t i = 0; i < op_codes.size(); i++)
+        op_codes[i].name = op_name(static_cast<InstructionType>(i));
+    // the code before the first label, followed by each label
+    std::vector<ProfileEntry> regions(labels.size() + 1);
+    regions[0].name = TOP_LEVEL;
+    for (size_t i = 0; i < labels.size(); i++){
+        regions[i + 1].name = labels[i].name;
+        regions[i + 1].address = labels[i].address;
+    }
+    size_t region {0};
+    size_t size = std::min(instructions.size(), counts.size());
+    for (size_t i = 0; i < size; i++){
+        while (region < labels.size() && labels[region].address <= i)
+            region++;
+        ProfileEntry& op_code = op_codes[static_cast<size_t>(instructions[i].op_code)];
+        op_code.count += counts[i];
+        op_code.cycles += cycles[i];
+        regions[region].count += counts[i];
+        regions[region].cycles += cycles[i];
+        summary.count += counts[i];
+        summary.cycles += cycles[i];
+        if (back_jumps[i]){
+            size_t target = instructions[i].arg.value().get_int();
+            summary.loops.push_back({label_name(labels, target), i, target, back_jumps[i], 0});
+        }
+    }
+    auto hotter = [](const ProfileEntry& a, const ProfileEntry& b){return a.cycles != b.cycles ? a.cycles > b.cycles : a.count > b.count;};
+    auto ran = [](const ProfileEntry& entry){return entry.count != 0;};
+    std::copy_if(op_codes.begin(), op_codes.end(), std::back_inserter(summary.op_codes), ran);
+    std::copy_if(regions.begin(), regions.end(), std::back_inserter(summary.labels), ran);
+    std::stable_sort(summary.op_codes.begin(), summary.op_codes.end(), hotter);
+    std::stable_sort(summary.labels.begin(), summary.labels.end(), hotter);
+    std::stable_sort(summary.loops.begin(), summary.loops.end(), [](const ProfileEntry& a, const ProfileEntry& b){return a.count > b.count;});
+    return summary;
+}
+
+static double percent(uint64_t part, uint64_t total){
+    return total ? 100.0 * part / total : 0.0;
+}
+
+void Profiler::report(std::ostream& out, const std::vector<Instruction>& instructions, const std::vector<ProgramLabel>& labels) const{
+    ProfileSummary summary = summarize(this->_counts, this->_cycles, this->_back_jumps, instructions, labels);
+    out << std::format("profile: {} instructions run in {} {}\n\n", summary.count, summary.cycles, PROFILE_CLOCK_UNIT);
+    out << std::format("{:<16}{:>14}{:>18}{:>8}\n", "op code", "count", PROFILE_CLOCK_UNIT, "%");
+    for (const ProfileEntry& entry : summary.op_codes)
+        out << std::format("{:<16}{:>14}{:>18}{:>8.1f}\n", entry.name, entry.count, entry.cycles, percent(entry.cycles, summary.cycles));
+    out << std::format("\n{:<24}{:>14}{:>18}{:>8}\n", "label", "count", PROFILE_CLOCK_UNIT, "%");
+    for (size_t i = 0; i < summary.labels.size() && i < REPORT_LIMIT; i++){
+        const ProfileEntry& entry = summary.labels[i];
+        out << std::format("{:<24}{:>14}{:>18}{:>8.1f}\n", entry.name, entry.count, entry.cycles, percent(entry.cycles, summary.cycles));
+    }
+    if (summary.loops.empty())
+        return;
+    out << std::format("\n{:<24}{:>10}{:>10}{:>14}\n", "loop", "jump", "target", "taken");
+    for (size_t i = 0; i < summary.loops.size() && i < REPORT_LIMIT; i++){
+        const ProfileEntry& entry = summary.loops[i];
+        out << std::format("{:<24}{:>10}{:>10}{:>14}\n", entry.name, entry.address, entry.target, entry.count);
+    }
+}
+
+// quotes a string for JSON
+static std::string json_string(std::string_view str){
+    std::string quoted {"\""};
+    for (char chr : str){
+        if (chr == '"' || chr == '\\')
+            quoted.push_back('\\');
+        if (static_cast<unsigned char>(chr) < 0x20)
+            quoted += std::format("\\u{:04x}", static_cast<int>(chr));
+        else
+            quoted.push_back(chr);
+    }
+    quoted.push_back('"');
+    return quoted;
+}
+
+void Profiler::write_json(std::ostream& out, const std::vector<Instruction>& instructions, const std::vector<ProgramLabel>& labels) const{
+    ProfileSummary summary = summarize(this->_counts, this->_cycles, this->_back_jumps, instructions, labels);
+    out << std::format("{{\n  \"clock\": \"{}\",\n  \"instructions\": {},\n  \"time\": {},\n", PROFILE_CLOCK_UNIT, summary.count, summary.cycles);
+    out << "  \"op_codes\": [";
+    for (size_t i = 0; i < summary.op_codes.size(); i++){
+        const ProfileEntry& entry = summary.op_codes[i];
+        out << std::format("{}\n    {{\"name\": {}, \"count\": {}, \"time\": {}}}", i ? "," : "", json_string(entry.name), entry.count, entry.cycles);
+    }
+    out << "\n  ],\n  \"labels\": [";
+    for (size_t i = 0; i < summary.labels.size(); i++){
+        const ProfileEntry& entry = summary.labels[i];
+        out << std::format("{}\n    {{\"name\": {}, \"address\": {}, \"count\": {}, \"time\": {}}}", i ? "," : "", json_string(entry.name), entry.address, entry.count, entry.cycles);
+    }
+    out << "\n  ],\n  \"loops\": [";
+    for (size_t i = 0; i < summary.loops.size(); i++){
+        const ProfileEntry& entry = summary.loops[i];
+        out << std::format("{}\n    {{\"label\": {}, \"jump\": {}, \"target\": {}, \"taken\": {}}}", i ? "," : "", json_string(entry.name), entry.address, entry.target, entry.count);
+    }
+    out << "\n  ]\n}" << std::endl;
+}
@@ -0,0 +1,529 @@
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include "../inc/value.hpp"
+#include "../inc/instruction.hpp"
+#include "../inc/register_vm.hpp"
+
+// the depth of the stack before an instruction runs, and which variables are certain to have been declared by then
+struct DepthState{
+    bool reached {false};
+    size_t depth {0};
+    std::vector<bool> declared;
+};
+
+// how an instruction changes the stack, it needs at least "needs" values, and pops "pops" values before pushing "pushes"
+struct StackEffect{
+    size_t needs;
+    size_t pops;
+    size_t pushes;
+};
+
+// returns the stack effect of an op code, or nullopt if the op code can't be translated. clear's effect depends on the depth
+static std::optional<StackEffect> stack_effect(InstructionType op_code, size_t depth){
+    switch (op_code){
+        case InstructionType::INST_NULL:
+        case InstructionType::INST_JUMP:
+        case InstructionType::INST_CALL:
+        case InstructionType::INST_RET:
+        case InstructionType::INST_INC_VAR:
+        case InstructionType::INST_FLUSH:
+            return StackEffect{0, 0, 0};
+        case InstructionType::INST_PUSH:
+        case InstructionType::INST_GET:
+        case InstructionType::INST_SIZE:
+        case InstructionType::INST_READ:
+        case InstructionType::INST_READINT:
+            return StackEffect{0, 0, 1};
+        case InstructionType::INST_POP:
+        case InstructionType::INST_SET:
+        case InstructionType::INST_JUMPIF:
+        case InstructionType::INST_PRINT_POP:
+        case InstructionType::INST_PRINTLN_POP:
+            return StackEffect{1, 1, 0};
+        case InstructionType::INST_PRINT:
+        case InstructionType::INST_PRINTLN:
+            return StackEffect{1, 0, 0};
+        case InstructionType::INST_DUP:
+            return StackEffect{1, 0, 1};
+        case InstructionType::INST_NOT:
+        case InstructionType::INST_LEN:
+        case InstructionType::INST_TYPE:
+        case InstructionType::INST_ADD_IMM:
+            return StackEffect{1, 1, 1};
+        case InstructionType::INST_SWAP:
+            return StackEffect{2, 2, 2};
+        case InstructionType::INST_PEEK:
+        case InstructionType::INST_ADD:
+        case InstructionType::INST_SUB:
+        case InstructionType::INST_MUL:
+        case InstructionType::INST_DIV:
+        case InstructionType::INST_MOD:
+        case InstructionType::INST_AND:
+        case InstructionType::INST_OR:
+        case InstructionType::INST_XOR:
+        case InstructionType::INST_NEQ:
+        case InstructionType::INST_EQ:
+        case InstructionType::INST_LESS:
+        case InstructionType::INST_GREATER:
+        case InstructionType::INST_LESS_EQ:
+        case InstructionType::INST_GREATER_EQ:
+        case InstructionType::INST_AT:
+        case InstructionType::INST_CONVERT:
+            return StackEffect{2, 2, op_code == InstructionType::INST_PEEK ? 2u : 1u};
+        case InstructionType::INST_JUMP_NEQ:
+        case InstructionType::INST_JUMP_EQ:
+        case InstructionType::INST_JUMP_LESS:
+        case InstructionType::INST_JUMP_GREATER:
+        case InstructionType::INST_JUMP_LESS_EQ:
+        case InstructionType::INST_JUMP_GREATER_EQ:
+            return StackEffect{2, 2, 0};
+        case InstructionType::INST_COND:
+            return StackEffect{3, 3, 1};
+        case InstructionType::INST_CLEAR:
+            return StackEffect{0, depth, 0};
+        default:
+            return std::nullopt;
+    }
+}
+
+// returns true if an op code can't run without an argument
+static bool needs_arg(InstructionType op_code){
+    switch (op_code){
+        case InstructionType::INST_PUSH:
+        case InstructionType::INST_GET:
+        case InstructionType::INST_SET:
+        case InstructionType::INST_INC_VAR:
+        case InstructionType::INST_ADD_IMM:
+            return true;
+        default:
+            return is_jump(op_code);
+    }
+}
+
+// returns the instructions that can run after the given one, the end of the program is the index one past the last instruction
+static void successors(const std::vector<Instruction>& instructions, size_t index, const std::vector<size_t>& return_addrs, std::vector<size_t>& out){
+    const Instruction& inst = instructions[index];
+    out.clear();
+    switch (inst.op_code){
+        case InstructionType::INST_RET:
+            out = return_addrs;
+            return;
+        case InstructionType::INST_JUMP:
+        case InstructionType::INST_CALL:
+            break;
+        default:
+            out.push_back(index + 1);
+            break;
+    }
+    if (is_jump(inst.op_code))
+        out.push_back(static_cast<size_t>(std::max(inst.arg.value().get_int(), 0)));
+    for (size_t& target : out)
+        target = std::min(target, instructions.size());
+}
+
+/*
+    finds the depth of the stack before every reachable instruction, returns false if any instruction can be reached
+    with two different depths, or is certain to fail its stack check. the depths of the end of the program are kept
+    in the last state
+*/
+static bool find_depths(const std::vector<Instruction>& instructions, const std::vector<size_t>& return_addrs, const DepthState& entry,
+                        size_t max_stack, std::vector<DepthState>& states){
+    size_t inst_count = instructions.size();
+    states.assign(inst_count + 1, DepthState());
+    states[0] = entry;
+    std::vector<size_t> worklist {0};
+    std::vector<size_t> next;
+    while (!worklist.empty()){
+        size_t index = worklist.back();
+        worklist.pop_back();
+        if (index == inst_count)
+            continue;
+        const Instruction& inst = instructions[index];
+        InstructionType op_code = generic_op(inst.op_code);
+        DepthState state = states[index];
+        std::optional<StackEffect> effect = stack_effect(op_code, state.depth);
+        if (!effect.has_value() || state.depth < effect->needs || (needs_arg(op_code) && !inst.arg.has_value()))
+            return false;
+        state.depth = state.depth - effect->pops + effect->pushes;
+        if (state.depth > max_stack)
+            return false;
+        // a get raises an error if its variable is undeclared, so the variable is declared after it as well
+        if (op_code == InstructionType::INST_SET || op_code == InstructionType::INST_GET)
+            state.declared[inst.arg.value().get_int()] = true;
+        successors(instructions, index, return_addrs, next);
+        for (size_t target : next){
+            DepthState& target_state = states[target];
+            if (!target_state.reached){
+                target_state = state;
+                worklist.push_back(target);
+                continue;
+            }
+            if (target_state.depth != state.depth)
+                return false;
+            // a variable is only certain to be declared if it's declared on every path
+            bool changed {false};
+            for (size_t i = 0; i < state.declared.size(); i++){
+                if (target_state.declared[i] && !state.declared[i]){
+                    target_state.declared[i] = false;
+                    changed = true;
+                }
+            }
+            if (changed)
+                worklist.push_back(target);
+        }
+    }
+    return true;
+}
+
+/*
+    emits the register code for a program, one stack instruction at a time. the translator keeps track of which register
+    holds the value of each stack slot, so pushing a variable or a literal doesn't emit anything, and the instruction
+    that uses it reads the variable or literal's register directly. before anything that can be jumped to, and before
+    a variable is changed, any slots still held in other registers are copied into their own registers
+*/
+class RegisterTranslator{
+    private:
+        const std::vector<Instruction>& _instructions;
+        const std::vector<DepthState>& _states;
+        RegisterProgram _program;
+        std::vector<uint32_t> _operands;
+        std::vector<std::pair<size_t, size_t>> _jumps;
+        bool _result_on_top {false};
+        uint32_t _slot(size_t index) const {return this->_program.stack_base + index;}
+        uint32_t _constant(const Value& val);
+        void _emit(const RegInstruction& inst);
+        void _emit_result(const RegInstruction& inst);
+        void _emit_jump(const RegInstruction& inst, size_t target);
+        void _materialize(size_t index);
+        void _flush(size_t count);
+        void _flush_var(uint32_t var);
+        void _translate(const Instruction& inst, size_t index);
+        void _binary(RegOp op);
+        void _unary(RegOp op);
+    public:
+        RegisterTranslator(const std::vector<Instruction>& instructions, const std::vector<DepthState>& states, size_t var_count, size_t max_depth);
+        RegisterProgram translate(const std::vector<bool>& block_starts);
+};
+
+RegisterTranslator::RegisterTranslator(const std::vector<Instruction>& instructions, const std::vector<DepthState>& states, size_t var_count, size_t max_depth)
+    : _instructions(instructions), _states(states){
+    this->_program.stack_base = var_count;
+    this->_program.const_base = var_count + max_depth;
+}
+
+// returns the register holding a literal
+uint32_t RegisterTranslator::_constant(const Value& val){
+    this->_program.constants.push_back(val);
+    return this->_program.const_base + this->_program.constants.size() - 1;
+}
+
+void RegisterTranslator::_emit(const RegInstruction& inst){
+    this->_program.code.push_back(inst);
+    this->_result_on_top = false;
+}
+
+// emits an instruction whose result is the new top of the stack, a set that follows it can redirect the result to its variable
+void RegisterTranslator::_emit_result(const RegInstruction& inst){
+    this->_emit(inst);
+    this->_result_on_top = true;
+}
+
+// emits a jump to a stack instruction, which is patched once every instruction has been translated
+void RegisterTranslator::_emit_jump(const RegInstruction& inst, size_t target){
+    this->_jumps.push_back({this->_program.code.size(), std::min(target, this->_instructions.size())});
+    this->_emit(inst);
+}
+
+// copies a stack slot's value into its own register, if it's still held in another one
+void RegisterTranslator::_materialize(size_t index){
+    if (this->_operands[index] == this->_slot(index))
+        return;
+    this->_emit(RegInstruction(RegOp::REG_MOVE, this->_slot(index), this->_operands[index]));
+    this->_operands[index] = this->_slot(index);
+}
+
+// materializes the given number of slots from the bottom of the stack
+void RegisterTranslator::_flush(size_t count){
+    for (size_t i = 0; i < count; i++)
+        this->_materialize(i);
+}
+
+// materializes every slot that's held in a variable's register, before the variable is changed
+void RegisterTranslator::_flush_var(uint32_t var){
+    for (size_t i = 0; i < this->_operands.size(); i++){
+        if (this->_operands[i] == var)
+            this->_materialize(i);
+    }
+}
+
+// replaces the top two slots with the result of an operation on them
+void RegisterTranslator::_binary(RegOp op){
+    size_t depth = this->_operands.size();
+    this->_emit_result(RegInstruction(op, this->_slot(depth - 2), this->_operands[depth - 2], this->_operands[depth - 1]));
+    this->_operands.pop_back();
+    this->_operands.back() = this->_slot(depth - 2);
+}
+
+// replaces the top slot with the result of an operation on it
+void RegisterTranslator::_unary(RegOp op){
+    size_t depth = this->_operands.size();
+    this->_emit_result(RegInstruction(op, this->_slot(depth - 1), this->_operands[depth - 1]));
+    this->_operands.back() = this->_slot(depth - 1);
+}
+
+// returns the register op for a binary stack op code
+static RegOp binary_op(InstructionType op_code){
+    return static_cast<RegOp>(static_cast<int>(RegOp::REG_ADD) + static_cast<int>(op_code) - static_cast<int>(InstructionType::INST_ADD));
+}
+
+// translates a single reachable stack instruction
+void RegisterTranslator::_translate(const Instruction& inst, size_t index){
+    InstructionType op_code = generic_op(inst.op_code);
+    size_t depth = this->_operands.size();
+    switch (op_code){
+        case InstructionType::INST_NULL:
+            break;
+        case InstructionType::INST_PUSH:
+            this->_operands.push_back(this->_constant(inst.arg.value()));
+            break;
+        case InstructionType::INST_SIZE:
+            this->_operands.push_back(this->_constant(Value(ValueType::TYPE_INT, static_cast<int>(depth))));
+            break;
+        case InstructionType::INST_POP:
+            this->_operands.pop_back();
+            break;
+        case InstructionType::INST_CLEAR:
+            this->_operands.clear();
+            break;
+        case InstructionType::INST_DUP:
+            if (this->_operands[depth - 1] != this->_slot(depth - 1)){
+                this->_operands.push_back(this->_operands[depth - 1]);
+                break;
+            }
+            this->_emit(RegInstruction(RegOp::REG_MOVE, this->_slot(depth), this->_slot(depth - 1)));
+            this->_operands.push_back(this->_slot(depth));
+            break;
+        case InstructionType::INST_SWAP:
+            // two slots that are both held elsewhere can be swapped without moving anything
+            if (this->_operands[depth - 1] != this->_slot(depth - 1) && this->_operands[depth - 2] != this->_slot(depth - 2)){
+                std::swap(this->_operands[depth - 1], this->_operands[depth - 2]);
+                break;
+            }
+            this->_materialize(depth - 2);
+            this->_materialize(depth - 1);
+            this->_emit(RegInstruction(RegOp::REG_SWAP, 0, this->_slot(depth - 2), this->_slot(depth - 1)));
+            break;
+        case InstructionType::INST_PEEK:
+            // the slot that's peeked at isn't known until the program runs, so every slot must be in its own register
+            this->_flush(depth);
+            this->_emit_result(RegInstruction(RegOp::REG_PEEK, this->_slot(depth - 1), this->_slot(depth - 1), depth - 1));
+            break;
+        case InstructionType::INST_GET:{
+            uint32_t var = inst.arg.value().get_int();
+            if (this->_states[index].declared[var]){
+                this->_operands.push_back(var);
+                break;
+            }
+            this->_emit_result(RegInstruction(RegOp::REG_GET, this->_slot(depth), var));
+            this->_operands.push_back(this->_slot(depth));
+            break;
+        }
+        case InstructionType::INST_SET:{
+            uint32_t var = inst.arg.value().get_int();
+            uint32_t top = this->_operands.back();
+            this->_operands.pop_back();
+            std::vector<RegInstruction>& code = this->_program.code;
+            // the instruction that computed the value can write it to the variable directly, unless a slot still holds the variable
+            if (this->_result_on_top && top == this->_slot(depth - 1) && std::find(this->_operands.begin(), this->_operands.end(), var) == this->_operands.end()){
+                code.back().dest = var;
+                this->_result_on_top = false;
+                break;
+            }
+            this->_flush_var(var);
+            this->_emit(RegInstruction(RegOp::REG_MOVE, var, top));
+            break;
+        }
+        case InstructionType::INST_INC_VAR:{
+            uint32_t var = inst.aux;
+            this->_flush_var(var);
+            if (this->_states[index].declared[var])
+                this->_emit(RegInstruction(RegOp::REG_ADD, var, var, this->_constant(inst.arg.value())));
+            else
+                this->_emit(RegInstruction(RegOp::REG_INC_VAR, var, 0, this->_constant(inst.arg.value())));
+            break;
+        }
+        case InstructionType::INST_ADD_IMM:
+            this->_emit_result(RegInstruction(RegOp::REG_ADD, this->_slot(depth - 1), this->_operands[depth - 1], this->_constant(inst.arg.value())));
+            this->_operands.back() = this->_slot(depth - 1);
+            break;
+        case InstructionType::INST_ADD:
+        case InstructionType::INST_SUB:
+        case InstructionType::INST_MUL:
+        case InstructionType::INST_DIV:
+        case InstructionType::INST_MOD:
+        case InstructionType::INST_AND:
+        case InstructionType::INST_OR:
+        case InstructionType::INST_XOR:
+        case InstructionType::INST_NEQ:
+        case InstructionType::INST_EQ:
+        case InstructionType::INST_LESS:
+        case InstructionType::INST_GREATER:
+        case InstructionType::INST_LESS_EQ:
+        case InstructionType::INST_GREATER_EQ:
+            this->_binary(binary_op(op_code));
+            break;
+        case InstructionType::INST_NOT:
+            this->_unary(RegOp::REG_NOT);
+            break;
+        case InstructionType::INST_LEN:
+            this->_unary(RegOp::REG_LEN);
+            break;
+        case InstructionType::INST_TYPE:
+            this->_unary(RegOp::REG_TYPE);
+            break;
+        // the index is below the collection, and the value is below its type
+        case InstructionType::INST_AT:
+            this->_binary(RegOp::REG_AT);
+            break;
+        case InstructionType::INST_CONVERT:
+            this->_binary(RegOp::REG_CONVERT);
+            break;
+        case InstructionType::INST_COND:
+            this->_emit_result(RegInstruction(RegOp::REG_COND, this->_slot(depth - 3), this->_operands[depth - 3], this->_operands[depth - 1], this->_operands[depth - 2]));
+            this->_operands.resize(depth - 2);
+            this->_operands.back() = this->_slot(depth - 3);
+            break;
+        case InstructionType::INST_PRINT:
+        case InstructionType::INST_PRINTLN:
+        case InstructionType::INST_PRINT_POP:
+        case InstructionType::INST_PRINTLN_POP:{
+            bool newline = op_code == InstructionType::INST_PRINTLN || op_code == InstructionType::INST_PRINTLN_POP;
+            this->_emit(RegInstruction(RegOp::REG_PRINT, 0, this->_operands[depth - 1], newline));
+            if (op_code == InstructionType::INST_PRINT_POP || op_code == InstructionType::INST_PRINTLN_POP)
+                this->_operands.pop_back();
+            break;
+        }
+        case InstructionType::INST_READ:
+        case InstructionType::INST_READINT:
+            this->_emit_result(RegInstruction(op_code == InstructionType::INST_READ ? RegOp::REG_READ : RegOp::REG_READINT, this->_slot(depth)));
+            this->_operands.push_back(this->_slot(depth));
+            break;
+        case InstructionType::INST_FLUSH:
+            this->_emit(RegInstruction(RegOp::REG_FLUSH));
+            break;
+        case InstructionType::INST_JUMP:
+            this->_flush(depth);
+            this->_emit_jump(RegInstruction(RegOp::REG_JUMP), inst.arg.value().get_int());
+            break;
+        case InstructionType::INST_CALL:
+            this->_flush(depth);
+            this->_emit_jump(RegInstruction(RegOp::REG_CALL, 0, 0, 0, index), inst.arg.value().get_int());
+            break;
+        case InstructionType::INST_RET:
+            this->_flush(depth);
+            this->_emit(RegInstruction(RegOp::REG_RET));
+            break;
+        case InstructionType::INST_JUMPIF:{
+            uint32_t cond = this->_operands.back();
+            this->_operands.pop_back();
+            this->_flush(depth - 1);
+            // a comparison that's only used by the jump becomes a compare and jump
+            std::vector<RegInstruction>& code = this->_program.code;
+            if (this->_result_on_top && cond == this->_slot(depth - 1) && code.back().op >= RegOp::REG_NEQ && code.back().op <= RegOp::REG_GREATER_EQ){
+                RegInstruction compare = code.back();
+                code.pop_back();
+                RegOp op = static_cast<RegOp>(static_cast<int>(RegOp::REG_JUMP_NEQ) + static_cast<int>(compare.op) - static_cast<int>(RegOp::REG_NEQ));
+                this->_emit_jump(RegInstruction(op, 0, compare.a, compare.b), inst.arg.value().get_int());
+                break;
+            }
+            this->_emit_jump(RegInstruction(RegOp::REG_JUMPIF, 0, cond), inst.arg.value().get_int());
+            break;
+        }
+        case InstructionType::INST_JUMP_NEQ:
+        case InstructionType::INST_JUMP_EQ:
+        case InstructionType::INST_JUMP_LESS:
+        case InstructionType::INST_JUMP_GREATER:
+        case InstructionType::INST_JUMP_LESS_EQ:
+        case InstructionType::INST_JUMP_GREATER_EQ:{
+            RegOp op = static_cast<RegOp>(static_cast<int>(RegOp::REG_JUMP_NEQ) + static_cast<int>(op_code) - static_cast<int>(InstructionType::INST_JUMP_NEQ));
+            uint32_t left = this->_operands[depth - 2], right = this->_operands[depth - 1];
+            this->_operands.resize(depth - 2);
+            this->_flush(depth - 2);
+            this->_emit_jump(RegInstruction(op, 0, left, right), inst.arg.value().get_int());
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+/*
+    translates every instruction in order. each instruction that can be jumped or returned to starts with every slot
+    in its own register, and instructions that are never reached are skipped
+*/
+RegisterProgram RegisterTranslator::translate(const std::vector<bool>& block_starts){
+    size_t inst_count = this->_instructions.size();
+    std::vector<uint32_t>& entry_points = this->_program.entry_points;
+    entry_points.assign(inst_count + 1, 0);
+    bool live {false};
+    for (size_t i = 0; i <= inst_count; i++){
+        const DepthState& state = this->_states[i];
+        if (block_starts[i]){
+            if (live)
+                this->_flush(this->_operands.size());
+            this->_operands.clear();
+            for (size_t slot = 0; slot < state.depth; slot++)
+                this->_operands.push_back(this->_slot(slot));
+            this->_result_on_top = false;
+        }
+        entry_points[i] = this->_program.code.size();
+        if (i == inst_count)
+            break;
+        live = state.reached;
+        if (!live)
+            continue;
+        const Instruction& inst = this->_instructions[i];
+        this->_translate(inst, i);
+        InstructionType op_code = inst.op_code;
+        if (op_code == InstructionType::INST_JUMP || op_code == InstructionType::INST_CALL || op_code == InstructionType::INST_RET)
+            live = false;
+    }
+    this->_program.exit_depth = this->_states[inst_count].depth;
+    this->_emit(RegInstruction(RegOp::REG_HALT));
+    for (const std::pair<size_t, size_t>& jump : this->_jumps)
+        this->_program.code[jump.first].target = entry_points[jump.second];
+    return this->_program;
+}
+
+std::optional<RegisterProgram> translate_to_registers(const std::vector<Instruction>& instructions, size_t entry_depth, const std::vector<Value>& vars, size_t max_stack){
+    size_t inst_count = instructions.size();
+    // a return goes to the instruction after any call, or to the second instruction if the call stack is empty
+    std::vector<size_t> return_addrs {std::min<size_t>(1, inst_count)};
+    std::vector<bool> block_starts(inst_count + 1, false);
+    block_starts[0] = true;
+    block_starts[inst_count] = true;
+    block_starts[return_addrs[0]] = true;
+    for (size_t i = 0; i < inst_count; i++){
+        const Instruction& inst = instructions[i];
+        if (inst.op_code == InstructionType::INST_CALL)
+            return_addrs.push_back(i + 1);
+        if (is_jump(inst.op_code) && inst.arg.has_value())
+            block_starts[std::min(static_cast<size_t>(std::max(inst.arg.value().get_int(), 0)), inst_count)] = true;
+        if (inst.op_code == InstructionType::INST_CALL)
+            block_starts[i + 1] = true;
+    }
+    DepthState entry;
+    entry.reached = true;
+    entry.depth = entry_depth;
+    for (const Value& var : vars)
+        entry.declared.push_back(var.get_type() != ValueType::TYPE_NULL);
+    std::vector<DepthState> states;
+    if (!find_depths(instructions, return_addrs, entry, max_stack, states))
+        return std::nullopt;
+    size_t max_depth {entry_depth};
+    for (const DepthState& state : states)
+        max_depth = std::max(max_depth, state.depth + 1);
+    RegisterTranslator translator(instructions, states, vars.size(), max_depth);
+    return translator.translate(block_starts);
+}
@@ -0,0 +1,121 @@
+#include <vector>
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <format>
+#include <algorithm>
+#include <unordered_map>
+#include <stdexcept>
+#include "../inc/instruction.hpp"
+#include "../inc/interpreter.hpp"
+#include "../inc/sampler.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define EVO_SAMPLING
+    #include <csignal>
+    #include <sys/time.h>
+#endif
+
+// the most lines shown by a report
+const size_t SAMPLE_REPORT_LIMIT {20};
+
+/*
+    the signal handler can't be given any arguments, so the sampler that's running shares its interpreter and sample
+    counts through these. the counts are allocated before sampling starts, so the handler only has to add to them
+*/
+static const Interpreter* volatile sampled_machine {nullptr};
+static uint64_t* volatile sample_counts {nullptr};
+static volatile size_t sample_slots {0};
+
+#ifdef EVO_SAMPLING
+static struct sigaction old_action;
+
+static void take_sample(int){
+    const Interpreter* machine = sampled_machine;
+    if (machine == nullptr)
+        return;
+    size_t op = machine->current_op();
+    size_t outside = sample_slots - 1;
+    sample_counts[std::min(op, outside)]++;
+}
+#endif
+
+Sampler::~Sampler(){
+    this->stop();
+}
+
+void Sampler::start(const Interpreter& machine, size_t inst_count){
+#ifdef EVO_SAMPLING
+    if (sampled_machine != nullptr)
+        throw std::runtime_error("Another program is already being sampled");
+    this->_samples.assign(inst_count + 1, 0);
+    sample_counts = this->_samples.data();
+    sample_slots = this->_samples.size();
+    sampled_machine = &machine;
+    struct sigaction action {};
+    action.sa_handler = take_sample;
+    // reads interrupted by a sample carry on as if nothing happened
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, &old_action);
+    struct itimerval timer {};
+    timer.it_interval.tv_usec = SAMPLE_INTERVAL_US;
+    timer.it_value.tv_usec = SAMPLE_INTERVAL_US;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    this->_running = true;
+#else
+    throw std::runtime_error("Sampling isn't supported on this platform");
+#endif
+}
+
+void Sampler::stop(){
+#ifdef EVO_SAMPLING
+    if (!this->_running)
+        return;
+    struct itimerval timer {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    sigaction(SIGPROF, &old_action, nullptr);
+    sampled_machine = nullptr;
+    sample_counts = nullptr;
+    sample_slots = 0;
+    this->_running = false;
+#endif
+}
+
+// returns the text of each line of the source, counting from 1
+static std::vector<std::string_view> split_lines(std::string_view source){
+    std::vector<std::string_view> lines {""};
+    size_t start {0};
+    while (start < source.size()){
+        size_t end = source.find('\n', start);
+        if (end == source.npos)
+            end = source.size();
+        lines.push_back(source.substr(start, end - start));
+        start = end + 1;
+    }
+    return lines;
+}
+
+void Sampler::report(std::ostream& out, const std::vector<LineEntry>& lines, std::string_view source) const{
+    uint64_t total {0};
+    std::unordered_map<size_t, uint64_t> line_samples;
+    for (size_t i = 0; i + 1 < this->_samples.size(); i++){
+        if (!this->_samples[i])
+            continue;
+        total += this->_samples[i];
+        line_samples[line_of(lines, i)] += this->_samples[i];
+    }
+    // the last slot counts the samples taken while no instruction was running, such as while the program was verified
+    uint64_t outside = this->_samples.empty() ? 0 : this->_samples.back();
+    std::vector<std::pair<size_t, uint64_t>> hottest(line_samples.begin(), line_samples.end());
+    std::sort(hottest.begin(), hottest.end(), [](const auto& a, const auto& b){return a.second != b.second ? a.second > b.second : a.first < b.first;});
+    out << std::format("samples: {} taken every {} us of CPU time, and {} more before or after running\n\n", total, SAMPLE_INTERVAL_US, outside);
+    out << std::format("{:>8}{:>12}{:>8}   {}\n", "line", "samples", "%", "source");
+    std::vector<std::string_view> text = split_lines(source);
+    for (size_t i = 0; i < hottest.size() && i < SAMPLE_REPORT_LIMIT; i++){
+        auto [line, samples] = hottest[i];
+        std::string_view line_text = line < text.size() ? text[line] : "";
+        line_text.remove_prefix(std::min(line_text.find_first_not_of(" \t"), line_text.size()));
+        out << std::format("{:>8}{:>12}{:>8.1f}   {}\n", line, samples, 100.0 * samples / total, line_text);
+    }
+}
@@ -0,0 +1,95 @@
+#include <string>
+#include <string_view>
+#include <stdexcept>
+#include "../inc/source_file.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+    #define EVO_MMAP_SOURCE
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <cerrno>
+#else
+    #include <fstream>
+    #include <iostream>
+    #include <iterator>
+#endif
+
+#ifdef EVO_MMAP_SOURCE
+// reads everything left in a file descriptor into a buffer, used for sources that can't be mapped
+static bool read_all(int fd, std::string& buffer){
+    size_t used {0};
+    buffer.resize(1 << 16);
+    while (true){
+        if (used == buffer.size())
+            buffer.resize(buffer.size() * 2);
+        ssize_t count = read(fd, buffer.data() + used, buffer.size() - used);
+        if (count == 0)
+            break;
+        if (count < 0){
+            if (errno == EINTR)
+                continue;
+            return false;
+        }
+        used += count;
+    }
+    buffer.resize(used);
+    return true;
+}
+
+SourceFile::SourceFile(const std::string& path){
+    if (path == "-"){
+        if (!read_all(STDIN_FILENO, this->_buffer))
+            throw std::runtime_error("Failed to read the program from stdin");
+        return;
+    }
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        throw std::runtime_error("Failed to read to program file. Does it exist?");
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode)){
+        // an empty file can't be mapped, and doesn't need to be
+        if (info.st_size > 0){
+            void* mapped = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED){
+                madvise(mapped, info.st_size, MADV_SEQUENTIAL);
+                this->_mapped = static_cast<const char*>(mapped);
+                this->_size = info.st_size;
+            }
+        }
+        if (this->_mapped || info.st_size == 0){
+            close(fd);
+            return;
+        }
+    }
+    bool success = read_all(fd, this->_buffer);
+    close(fd);
+    if (!success)
+        throw std::runtime_error("Failed to read to program file. Does it exist?");
+}
+
+SourceFile::~SourceFile(){
+    if (this->_mapped)
+        munmap(const_cast<char*>(this->_mapped), this->_size);
+}
+#else
+SourceFile::SourceFile(const std::string& path){
+    if (path == "-"){
+        this->_buffer.assign(std::istreambuf_iterator<char>(std::cin), std::istreambuf_iterator<char>());
+        return;
+    }
+    std::ifstream file(path, std::ios::binary);
+    if (!file.good())
+        throw std::runtime_error("Failed to read to program file. Does it exist?");
+    this->_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+SourceFile::~SourceFile(){}
+#endif
+
+std::string_view SourceFile::text() const{
+    if (this->_mapped)
+        return std::string_view(this->_mapped, this->_size);
+    return this->_buffer;
+}
@@ -0,0 +1,289 @@
+#include <vector>
+#include <string>
+#include <string_view>
+#include <ostream>
+#include <fstream>
+#include <format>
+#include <cstring>
+#include <algorithm>
+#include <stdexcept>
+#include "../inc/value.hpp"
+#include "../inc/instruction.hpp"
+#include "../inc/trace.hpp"
+
+// the layout of the start of a trace file, the records follow the label names
+struct TraceHeader{
+    char magic[4];
+    uint32_t version;
+    uint32_t label_count;
+    uint32_t string_size;
+};
+
+struct TraceLabel{
+    uint32_t offset;    // the offset of the name in the label names
+    uint32_t length;
+    uint32_t address;
+};
+
+const char EVOT_MAGIC[4] {'E', 'V', 'O', 'T'};
+// the most jumps and callees shown by a report
+const size_t TRACE_REPORT_LIMIT {20};
+// the deepest calls shown in the call tree, deeper calls are still counted in their callers' totals
+const size_t TRACE_TREE_DEPTH {16};
+// the name given to the code that isn't in any call
+const std::string_view TRACE_TOP_LEVEL {"(top level)"};
+
+TraceWriter::TraceWriter(const std::string& path, const std::vector<ProgramLabel>& labels) : _block(TRACE_BLOCK_RECORDS){
+    this->_file.open(path, std::ios::binary | std::ios::trunc);
+    if (!this->_file.good())
+        throw std::runtime_error("Failed to create the trace file \"" + path + "\"");
+    std::vector<TraceLabel> file_labels;
+    std::string names;
+    for (const ProgramLabel& label : labels){
+        file_labels.push_back({static_cast<uint32_t>(names.size()), static_cast<uint32_t>(label.name.size()), static_cast<uint32_t>(label.address)});
+        names.append(label.name);
+    }
+    TraceHeader header{};
+    std::memcpy(header.magic, EVOT_MAGIC, sizeof(EVOT_MAGIC));
+    header.version = EVOT_VERSION;
+    header.label_count = file_labels.size();
+    header.string_size = names.size();
+    this->_file.write(reinterpret_cast<const char*>(&header), sizeof(TraceHeader));
+    this->_file.write(reinterpret_cast<const char*>(file_labels.data()), file_labels.size() * sizeof(TraceLabel));
+    this->_file.write(names.data(), names.size());
+}
+
+TraceWriter::~TraceWriter(){
+    if (this->_file.is_open())
+        this->_write_block();
+}
+
+void TraceWriter::_write_block(){
+    this->_file.write(reinterpret_cast<const char*>(this->_block.data()), this->_used * sizeof(TraceRecord));
+    this->_used = 0;
+}
+
+void TraceWriter::close(){
+    if (!this->_file.is_open())
+        return;
+    this->_write_block();
+    this->_file.close();
+    if (this->_file.fail())
+        throw std::runtime_error("Failed to write the trace file");
+}
+
+// what was run under a single path of calls
+struct CallNode{
+    size_t address;     // the address the call jumped to
+    size_t parent;
+    uint64_t calls {0};
+    uint64_t self {0};  // the instructions run in this call, not counting the calls it made
+    uint64_t total {0};
+    std::vector<size_t> children;
+};
+
+struct JumpStats{
+    InstructionType op_code {InstructionType::INST_NULL};
+    uint64_t executed {0};
+    uint64_t taken {0};
+    uint64_t backward {0};
+};
+
+// a decoded trace file
+struct Trace{
+    std::vector<ProgramLabel> labels;
+    std::string_view records;
+    size_t size() const {return this->records.size() / sizeof(TraceRecord);}
+    TraceRecord operator[](size_t index) const{
+        TraceRecord rec;
+        std::memcpy(&rec, this->records.data() + index * sizeof(TraceRecord), sizeof(TraceRecord));
+        return rec;
+    }
+};
+
+static Trace read_trace(std::string_view bytes){
+    const std::runtime_error invalid("Invalid trace file");
+    TraceHeader header;
+    if (bytes.size() < sizeof(TraceHeader))
+        throw invalid;
+    std::memcpy(&header, bytes.data(), sizeof(TraceHeader));
+    if (std::memcmp(header.magic, EVOT_MAGIC, sizeof(EVOT_MAGIC)) != 0)
+        throw invalid;
+    if (header.version != EVOT_VERSION)
+        throw std::runtime_error(std::format("Trace file is version {}, but this version of evo reads version {}", header.version, EVOT_VERSION));
+    uint64_t names_offset = sizeof(TraceHeader) + uint64_t(header.label_count) * sizeof(TraceLabel);
+    uint64_t records_offset = names_offset + header.string_size;
+    if (records_offset > bytes.size() || (bytes.size() - records_offset) % sizeof(TraceRecord) != 0)
+        throw invalid;
+    std::string_view names = bytes.substr(names_offset, header.string_size);
+    Trace trace;
+    for (size_t i = 0; i < header.label_count; i++){
+        TraceLabel label;
+        std::memcpy(&label, bytes.data() + sizeof(TraceHeader) + i * sizeof(TraceLabel), sizeof(TraceLabel));
+        if (uint64_t(label.offset) + label.length > names.size() || (!trace.labels.empty() && label.address < trace.labels.back().address))
+            throw invalid;
+        trace.labels.push_back({std::string(names.substr(label.offset, label.length)), label.address});
+    }
+    trace.records = bytes.substr(records_offset);
+    for (size_t i = 0; i < trace.size(); i++){
+        TraceRecord rec = trace[i];
+        if (rec.op_code >= static_cast<uint8_t>(InstructionType::INST_COUNT) || rec.top_type >= VALUE_TYPE_COUNT)
+            throw invalid;
+    }
+    return trace;
+}
+
+// names the code at an address by its label, and how far past the label it is
+static std::string address_name(const std::vector<ProgramLabel>& labels, size_t address){
+    const ProgramLabel* label = label_of(labels, address);
+    if (label == nullptr)
+        return std::format("@{}", address);
+    if (label->address == address)
+        return label->name;
+    return std::format("{}+{}", label->name, address - label->address);
+}
+
+// describes the value on top of the stack when a record was made
+static std::string describe_top(const TraceRecord& rec){
+    ValueType type = static_cast<ValueType>(rec.top_type);
+    switch (type){
+        case ValueType::TYPE_INT:
+            return std::to_string(static_cast<int32_t>(rec.top));
+        case ValueType::TYPE_FLOAT:{
+            float float_val;
+            std::memcpy(&float_val, &rec.top, sizeof(float));
+            return std::format("{}", float_val);
+        }
+        case ValueType::TYPE_BOOL:
+            return rec.top ? "true" : "false";
+        case ValueType::TYPE_CHAR:
+            return std::format("'{}'", static_cast<char>(rec.top));
+        case ValueType::TYPE_VALTYPE:
+            return rec.top < VALUE_TYPE_COUNT ? std::format("type {}", type_traits(static_cast<ValueType>(rec.top)).name) : "type ?";
+        case ValueType::TYPE_STR:
+        case ValueType::TYPE_NAME:
+            return std::format("{} of length {}", type_traits(type).name, rec.top);
+        default:
+            return "";
+    }
+}
+
+static double percent(uint64_t part, uint64_t total){
+    return total ? 100.0 * part / total : 0.0;
+}
+
+static void print_tree(std::ostream& out, const std::vector<CallNode>& nodes, const std::vector<ProgramLabel>& labels, size_t index, size_t depth){
+    const CallNode& node = nodes[index];
+    std::string name = index ? address_name(labels, node.address) : std::string(TRACE_TOP_LEVEL);
+    out << std::format("{:<40}{:>10}{:>14}{:>14}\n", std::string(2 * depth, ' ') + name, node.calls, node.total, node.self);
+    if (node.children.empty())
+        return;
+    if (depth == TRACE_TREE_DEPTH){
+        out << std::string(2 * depth + 2, ' ') << "...\n";
+        return;
+    }
+    std::vector<size_t> children = node.children;
+    std::stable_sort(children.begin(), children.end(), [&](size_t a, size_t b){return nodes[a].total > nodes[b].total;});
+    for (size_t child : children)
+        print_tree(out, nodes, labels, child, depth + 1);
+}
+
+void report_trace(std::ostream& out, std::string_view bytes, bool dump){
+    Trace trace = read_trace(bytes);
+    size_t count = trace.size();
+    if (dump){
+        out << std::format("{:>10}{:>10}  {:<16}{:>8}  {}\n", "record", "address", "op code", "depth", "top");
+        for (size_t i = 0; i < count; i++){
+            TraceRecord rec = trace[i];
+            out << std::format("{:>10}{:>10}  {:<16}{:>8}  {}\n", i, rec.address, op_name(static_cast<InstructionType>(rec.op_code)), rec.depth, describe_top(rec));
+        }
+        return;
+    }
+    std::vector<uint64_t> op_counts(static_cast<size_t>(InstructionType::INST_COUNT));
+    std::vector<JumpStats> jumps;
+    // the root of the call tree is the code that isn't in any call
+    std::vector<CallNode> nodes {{0, 0, 1, 0, 0, {}}};
+    size_t current {0};
+    uint32_t peak_depth {0};
+    for (size_t i = 0; i < count; i++){
+        TraceRecord rec = trace[i];
+        InstructionType op_code = static_cast<InstructionType>(rec.op_code);
+        op_counts[rec.op_code]++;
+        nodes[current].self++;
+        peak_depth = std::max(peak_depth, rec.depth);
+        // the instruction after a jump is the one it went to, the program ended if there isn't one
+        bool has_next = i + 1 < count;
+        uint32_t next = has_next ? trace[i + 1].address : 0;
+        if (op_code == InstructionType::INST_CALL && has_next){
+            auto child = std::find_if(nodes[current].children.begin(), nodes[current].children.end(), [&](size_t index){return nodes[index].address == next;});
+            size_t callee;
+            if (child != nodes[current].children.end())
+                callee = *child;
+            else{
+                callee = nodes.size();
+                nodes[current].children.push_back(callee);
+                nodes.push_back({next, current, 0, 0, 0, {}});
+            }
+            nodes[callee].calls++;
+            current = callee;
+        }
+        else if (op_code == InstructionType::INST_RET)
+            current = nodes[current].parent;
+        else if (is_jump(op_code)){
+            if (rec.address >= jumps.size())
+                jumps.resize(rec.address + 1);
+            JumpStats& jump = jumps[rec.address];
+            jump.op_code = op_code;
+            jump.executed++;
+            if (has_next && next != rec.address + 1){
+                jump.taken++;
+                if (next <= rec.address)
+                    jump.backward++;
+            }
+        }
+    }
+    // every node is created after its parent, so totals can be summed from the last node back
+    for (size_t i = nodes.size(); i-- > 0;){
+        nodes[i].total += nodes[i].self;
+        if (i)
+            nodes[nodes[i].parent].total += nodes[i].total;
+    }
+    out << std::format("trace: {} instructions, with at most {} values on the stack\n\n", count, peak_depth);
+    out << std::format("{:<16}{:>14}{:>8}\n", "op code", "count", "%");
+    std::vector<size_t> op_codes;
+    for (size_t i = 0; i < op_counts.size(); i++)
+        if (op_counts[i])
+            op_codes.push_back(i);
+    std::stable_sort(op_codes.begin(), op_codes.end(), [&](size_t a, size_t b){return op_counts[a] > op_counts[b];});
+    for (size_t op_code : op_codes)
+        out << std::format("{:<16}{:>14}{:>8.1f}\n", op_name(static_cast<InstructionType>(op_code)), op_counts[op_code], percent(op_counts[op_code], count));
+    std::vector<size_t> jump_addrs;
+    for (size_t i = 0; i < jumps.size(); i++)
+        if (jumps[i].executed)
+            jump_addrs.push_back(i);
+    if (!jump_addrs.empty()){
+        std::stable_sort(jump_addrs.begin(), jump_addrs.end(), [&](size_t a, size_t b){return jumps[a].executed > jumps[b].executed;});
+        out << std::format("\n{:<24}{:<16}{:>14}{:>8}{:>14}\n", "jump", "op code", "executed", "taken%", "backward");
+        for (size_t i = 0; i < jump_addrs.size() && i < TRACE_REPORT_LIMIT; i++){
+            const JumpStats& jump = jumps[jump_addrs[i]];
+            out << std::format("{:<24}{:<16}{:>14}{:>8.1f}{:>14}\n", address_name(trace.labels, jump_addrs[i]), op_name(jump.op_code), jump.executed, percent(jump.taken, jump.executed), jump.backward);
+        }
+    }
+    if (nodes.size() == 1)
+        return;
+    // the calls to each callee, wherever they were made from
+    std::vector<CallNode> callees;
+    for (size_t i = 1; i < nodes.size(); i++){
+        auto callee = std::find_if(callees.begin(), callees.end(), [&](const CallNode& entry){return entry.address == nodes[i].address;});
+        if (callee == callees.end())
+            callee = callees.insert(callees.end(), CallNode{nodes[i].address, 0, 0, 0, 0, {}});
+        callee->calls += nodes[i].calls;
+        callee->self += nodes[i].self;
+    }
+    std::stable_sort(callees.begin(), callees.end(), [](const CallNode& a, const CallNode& b){return a.self > b.self;});
+    out << std::format("\n{:<24}{:>10}{:>14}{:>8}\n", "callee", "calls", "self", "%");
+    for (size_t i = 0; i < callees.size() && i < TRACE_REPORT_LIMIT; i++)
+        out << std::format("{:<24}{:>10}{:>14}{:>8.1f}\n", address_name(trace.labels, callees[i].address), callees[i].calls, callees[i].self, percent(callees[i].self, count));
+    out << std::format("\n{:<40}{:>10}{:>14}{:>14}\n", "call tree", "calls", "total", "self");
+    print_tree(out, nodes, trace.labels, 0, 0);
+}
@@ -1,73 +1,110 @@
-#include <unordered_map>
 #include <stdexcept>
 #include <string>
 #include <iostream>
+#include <charconv>
+#include <cstring>
 #include "../inc/value.hpp"
 
-// associates the four main value types with their names as strings, using the numeric enum values as an index
-const char* TYPE_ARR[]{
-    "int",
-    "bool",
-    "char",
-    "string"
-};
+// copies a value, sharing its string if it has one
+Value::Value(const Value& other) : _type(other._type), _str(other._str){
+    if (this->_has_str())
+        this->_str->refs++;
+}
+
+// moves a value, leaving the original value null
+Value::Value(Value&& other) noexcept : _type(other._type), _str(other._str){
+    other._type = ValueType::TYPE_NULL;
+}
+
+Value& Value::operator=(const Value& other){
+    if (other._has_str())
+        other._str->refs++;
+    this->_release();
+    this->_type = other._type;
+    this->_str = other._str;
+    return *this;
+}
+
+Value& Value::operator=(Value&& other) noexcept{
+    if (this != &other){
+        this->_release();
+        this->_type = other._type;
+        this->_str = other._str;
+        other._type = ValueType::TYPE_NULL;
+    }
+    return *this;
+}
 
-// returns true if the value is an integral type
-bool Value::is_intergral() const{
-    std::unordered_map<ValueType, short> lookup = {
-        {ValueType::TYPE_INT, 0},
-        {ValueType::TYPE_CHAR, 0},
-        {ValueType::TYPE_BOOL, 0}
-    };
-    return lookup.count(this->_type) != 0;
+// drops this value's reference to its string, freeing the string if this was the last reference
+void Value::_release(){
+    if (this->_has_str() && --this->_str->refs == 0)
+        delete this->_str;
 }
 
 // converts any integral type variable to an integer, raises an error if this is not an integral type
 int Value::as_int() const{
     if (!this->is_intergral())
         throw std::runtime_error("Cannot convert non-integral type to int");
-    switch (this->_type){
-        case ValueType::TYPE_INT: return std::get<int>(this->_val);
-        case ValueType::TYPE_CHAR: return static_cast<int>(std::get<char>(this->_val));
-        case ValueType::TYPE_BOOL: return static_cast<int>(std::get<bool>(this->_val));
-    }
-    
+    // bools and chars are stored widened to an int, so no conversion is needed
+    return this->_int;
 }
 
 /// returns a string representation of the value, used for printing or conversion
-std::string Value::to_string() const{
+std::string Value::to_string(FloatFormat format) const{
+    if (this->_has_str())
+        return this->_str->str;
+    char text[MAX_SCALAR_CHARS];
+    return std::string(text, this->format_scalar(text, format));
+}
+
+// copies a string that's known to fit into the text of a value
+static char* copy_text(char* out, std::string_view text){
+    std::memcpy(out, text.data(), text.size());
+    return out + text.size();
+}
+
+/*
+    numbers are written with to_chars, which never allocates and doesn't depend on the locale. the fixed format
+    writes the same digits as printf's %f, which is what floats have always been printed with
+*/
+char* Value::format_scalar(char* out, FloatFormat format) const{
+    char* end = out + MAX_SCALAR_CHARS;
     switch (this->_type){
         case ValueType::TYPE_INT:
-            return std::to_string(std::get<int>(this->_val));
+            return std::to_chars(out, end, this->_int).ptr;
         case ValueType::TYPE_FLOAT:
-            return std::to_string(std::get<float>(this->_val));
-        case ValueType::TYPE_STR:
-        case ValueType::TYPE_NAME:
-            return std::get<std::string>(this->_val);
+            if (format == FloatFormat::FLOAT_SHORTEST)
+                return std::to_chars(out, end, this->_float).ptr;
+            return std::to_chars(out, end, this->_float, std::chars_format::fixed, 6).ptr;
         case ValueType::TYPE_BOOL:
-            return (std::get<bool>(this->_val)) ? "TRUE" : "FALSE";
+            return copy_text(out, this->_int ? "TRUE" : "FALSE");
         case ValueType::TYPE_CHAR:
-            return std::string(1, std::get<char>(this->_val));
+            *out = static_cast<char>(this->_int);
+            return out + 1;
         case ValueType::TYPE_VALTYPE:
-            return TYPE_ARR[std::get<int>(this->_val)];
+            return copy_text(out, type_traits(static_cast<ValueType>(this->_int)).name);
+        case ValueType::TYPE_STR:
+        case ValueType::TYPE_NAME:
         case ValueType::TYPE_NULL:
-            return "";
+            return out;
     }
-    return "ERROR TYPE";
+    return copy_text(out, "ERROR TYPE");
 }
 
 // converts a value to a boolen, if the value is not an integral type, this will throw an error
 bool Value::as_bool() const{
     if (!this->is_intergral())
         throw std::runtime_error("Invalid type for boolean conversion");
-    return this->as_int() != 0;
+    return this->_int != 0;
 }
 
-// converts a value to a character, if the value is not a integer, this will throw an error
+// converts a value to a character, if the value is not a string or integral type, this will throw an error
 char Value::as_char() const{
     if (this->_type == ValueType::TYPE_STR)
-        return std::get<std::string>(this->_val)[0];
-    return static_cast<char>(std::get<int>(this->_val));
+        return this->_str->str[0];
+    if (!this->is_intergral())
+        throw std::runtime_error("Invalid type for character conversion");
+    return static_cast<char>(this->_int);
 }
 
 // creates any integral (or floating point) type Value from an integer 
@@ -87,7 +124,7 @@ Value Value::get_index(size_t index) const{
     if (!this->is_collection())
         throw std::runtime_error("Cannot get an index of a non-collection type.");
     // when arrays are implemented, this will be changed to a switch case, but for now, this function always runs for string values
-    std::string str = std::get<std::string>(this->_val);
+    const std::string& str = this->_str->str;
     if (index >= str.size())
         throw std::out_of_range("Index out of range");
     return Value(ValueType::TYPE_CHAR, str.at(index));
@@ -97,31 +134,32 @@ Value Value::get_index(size_t index) const{
 size_t Value::get_len() const{
     if (!this->is_collection())
         throw std::runtime_error("Cannot get the length of a non-collection type.");
-    std::string str = std::get<std::string>(this->_val);
-    return str.length();
-}
-
-/* 
-    returns true if this value is a collection type, at the moment, this only returns true if
-    the Value is a string, however, this is it's own function to account for future array support
-*/
-bool Value::is_collection() const{
-    return this->_type == ValueType::TYPE_STR;
+    return this->_str->str.length();
 }
 
 // returns if two values are equal in both type and value
-bool Value::operator==(const Value& rhs){
+bool Value::operator==(const Value& rhs) const{
     if (this->_type != rhs._type)
         return false;
-    return this->_val == rhs._val;
+    switch (this->_type){
+        case ValueType::TYPE_FLOAT:
+            return this->_float == rhs._float;
+        case ValueType::TYPE_STR:
+        case ValueType::TYPE_NAME:
+            return this->_str == rhs._str || this->_str->str == rhs._str->str;
+        case ValueType::TYPE_NULL:
+            return true;
+        default:
+            return this->_int == rhs._int;
+    }
 }
 
 // returns if two values are inequal in type and/or value
-bool Value::operator!=(const Value& rhs){
+bool Value::operator!=(const Value& rhs) const{
     return !(*this == rhs);
 }
 
 // greater than comparison for values, do not call this unless you've ensured both types are integrals
-bool Value::operator>(const Value& rhs){
+bool Value::operator>(const Value& rhs) const{
     return this->as_int() > rhs.as_int();
 }
\ No newline at end of file
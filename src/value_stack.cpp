@@ -0,0 +1,41 @@
+#include <new>
+#include <utility>
+#include <cstdint>
+#include <stdexcept>
+#include <format>
+#include "../inc/value.hpp"
+#include "../inc/value_stack.hpp"
+
+ValueStack::~ValueStack(){
+    this->clear();
+    ::operator delete(this->_data);
+}
+
+// moves the stack to storage with the given capacity, which must be at least its size. throws an error if it can't be allocated
+void ValueStack::set_capacity(size_t capacity){
+    // the size in bytes would wrap around past this, and a smaller block would be allocated than the capacity says
+    if (capacity > SIZE_MAX / sizeof(Value))
+        throw std::runtime_error(std::format("Stack Error: a stack limit of {} values is too large to allocate", capacity));
+    Value* data;
+    try{
+        data = static_cast<Value*>(::operator new(capacity * sizeof(Value)));
+    }
+    catch (const std::bad_alloc&){
+        throw std::runtime_error(std::format("Stack Error: a stack limit of {} values is too large to allocate", capacity));
+    }
+    for (size_t i = 0; i < this->_size; i++){
+        new (&data[i]) Value(std::move(this->_data[i]));
+        this->_data[i].~Value();
+    }
+    ::operator delete(this->_data);
+    this->_data = data;
+    this->_capacity = capacity;
+}
+
+// destroys values above the new size, or fills the stack with null values up to it
+void ValueStack::resize(size_t size){
+    while (this->_size > size)
+        this->pop_back();
+    while (this->_size < size)
+        new (&this->_data[this->_size++]) Value();
+}
@@ -0,0 +1,341 @@
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include "../inc/value.hpp"
+#include "../inc/instruction.hpp"
+#include "../inc/verifier.hpp"
+
+// values of unknown type are tracked as null, a null value can't pass any of the checks the verifier removes
+const ValueType TYPE_UNKNOWN {ValueType::TYPE_NULL};
+
+// the abstract state of the stack before an instruction runs, types[0] is the type of the top value
+struct StackState{
+    bool reached {false};
+    size_t depth {0};
+    ValueType types[VERIFIER_TRACKED_TYPES];
+    StackState() {std::fill(std::begin(this->types), std::end(this->types), TYPE_UNKNOWN);}
+    ValueType type_at(size_t index) const;
+    void pop(size_t count);
+    void push(ValueType type);
+    bool merge(const StackState& other);
+};
+
+// returns the type of the value the given number of places below the top of the stack
+ValueType StackState::type_at(size_t index) const{
+    if (index >= this->depth || index >= VERIFIER_TRACKED_TYPES)
+        return TYPE_UNKNOWN;
+    return this->types[index];
+}
+
+// removes values from the top of the stack, the depth never drops below zero as a shallower stack is an error at runtime
+void StackState::pop(size_t count){
+    for (size_t i = 0; i < VERIFIER_TRACKED_TYPES; i++)
+        this->types[i] = (i + count < VERIFIER_TRACKED_TYPES) ? this->types[i + count] : TYPE_UNKNOWN;
+    this->depth = (count < this->depth) ? this->depth - count : 0;
+}
+
+void StackState::push(ValueType type){
+    for (size_t i = VERIFIER_TRACKED_TYPES - 1; i > 0; i--)
+        this->types[i] = this->types[i - 1];
+    this->types[0] = type;
+    this->depth++;
+}
+
+// merges the state from another path into this one, returns true if this state changed
+bool StackState::merge(const StackState& other){
+    if (!this->reached){
+        *this = other;
+        this->reached = true;
+        return true;
+    }
+    bool changed {false};
+    size_t depth = std::min(this->depth, other.depth);
+    for (size_t i = 0; i < VERIFIER_TRACKED_TYPES; i++){
+        ValueType type = (this->type_at(i) == other.type_at(i) && i < depth) ? this->type_at(i) : TYPE_UNKNOWN;
+        if (type != this->type_at(i))
+            changed = true;
+        this->types[i] = type;
+    }
+    if (depth != this->depth)
+        changed = true;
+    this->depth = depth;
+    return changed;
+}
+
+// the type of each variable slot, nullopt until a value has been stored in it
+typedef std::vector<std::optional<ValueType>> VarTypes;
+
+// merges a stored type into a variable's type, a variable that stores mixed types has an unknown type
+static std::optional<ValueType> merge_type(std::optional<ValueType> type, ValueType stored){
+    if (!type.has_value() || type.value() == stored)
+        return stored;
+    return TYPE_UNKNOWN;
+}
+
+static bool is_numeric(ValueType type){
+    return type_traits(type).numeric;
+}
+
+static bool is_integral(ValueType type){
+    return type_traits(type).integral;
+}
+
+// returns the first of two types that satisfies a predicate, if an operation succeeds both operands have this type
+static ValueType known_type(ValueType left, ValueType right, bool (*predicate)(ValueType)){
+    if (predicate(left))
+        return left;
+    if (predicate(right))
+        return right;
+    return TYPE_UNKNOWN;
+}
+
+/*
+    applies an instruction to the abstract state, turning it into the state after the instruction has run.
+    returns true if every stack depth and type check the instruction makes is guaranteed to pass
+*/
+static bool apply_inst(const Instruction& inst, StackState& state, const VarTypes& var_types){
+    ValueType top = state.type_at(0), second = state.type_at(1);
+    size_t depth = state.depth;
+    switch (inst.op_code){
+        case InstructionType::INST_NULL:
+        case InstructionType::INST_JUMP:
+        case InstructionType::INST_CALL:
+        case InstructionType::INST_RET:
+        case InstructionType::INST_FLUSH:
+            return true;
+        case InstructionType::INST_PUSH:
+            state.push(inst.arg.has_value() ? inst.arg.value().get_type() : TYPE_UNKNOWN);
+            return inst.arg.has_value();
+        case InstructionType::INST_POP:
+        case InstructionType::INST_SET:
+        case InstructionType::INST_PRINT_POP:
+        case InstructionType::INST_PRINTLN_POP:
+            state.pop(1);
+            return depth >= 1;
+        case InstructionType::INST_PRINT:
+        case InstructionType::INST_PRINTLN:
+            return depth >= 1;
+        case InstructionType::INST_CLEAR:
+            state.pop(depth);
+            return true;
+        case InstructionType::INST_PEEK:
+            state.pop(1);
+            state.push(TYPE_UNKNOWN);
+            return depth >= 2 && top == ValueType::TYPE_INT;
+        case InstructionType::INST_SWAP:
+            state.pop(2);
+            state.push(top);
+            state.push(second);
+            return depth >= 2;
+        case InstructionType::INST_SIZE:
+        case InstructionType::INST_READINT:
+            state.push(ValueType::TYPE_INT);
+            return true;
+        case InstructionType::INST_READ:
+            state.push(ValueType::TYPE_STR);
+            return true;
+        case InstructionType::INST_DUP:
+            state.push(top);
+            return depth >= 1;
+        case InstructionType::INST_ADD:
+        case InstructionType::INST_SUB:
+        case InstructionType::INST_MUL:
+        case InstructionType::INST_DIV:
+            state.pop(2);
+            state.push(known_type(second, top, is_numeric));
+            return depth >= 2 && top == second && is_numeric(top);
+        case InstructionType::INST_MOD:
+            state.pop(2);
+            state.push(ValueType::TYPE_INT);
+            return depth >= 2 && top == second && top == ValueType::TYPE_INT;
+        case InstructionType::INST_AND:
+        case InstructionType::INST_OR:
+        case InstructionType::INST_XOR:
+            state.pop(2);
+            state.push(known_type(second, top, is_integral));
+            return depth >= 2 && top == second && is_integral(top);
+        case InstructionType::INST_NOT:
+            state.pop(1);
+            state.push(ValueType::TYPE_BOOL);
+            return depth >= 1 && is_integral(top);
+        case InstructionType::INST_NEQ:
+        case InstructionType::INST_EQ:
+            state.pop(2);
+            state.push(ValueType::TYPE_BOOL);
+            return depth >= 2;
+        case InstructionType::INST_LESS:
+        case InstructionType::INST_GREATER:
+        case InstructionType::INST_LESS_EQ:
+        case InstructionType::INST_GREATER_EQ:
+            state.pop(2);
+            state.push(ValueType::TYPE_BOOL);
+            return depth >= 2 && is_integral(top) && is_integral(second);
+        case InstructionType::INST_JUMPIF:
+            state.pop(1);
+            return depth >= 1 && is_integral(top);
+        case InstructionType::INST_JUMP_NEQ:
+        case InstructionType::INST_JUMP_EQ:
+            state.pop(2);
+            return depth >= 2;
+        case InstructionType::INST_JUMP_LESS:
+        case InstructionType::INST_JUMP_GREATER:
+        case InstructionType::INST_JUMP_LESS_EQ:
+        case InstructionType::INST_JUMP_GREATER_EQ:
+            state.pop(2);
+            return depth >= 2 && is_integral(top) && is_integral(second);
+        case InstructionType::INST_GET:{
+            // nothing has been stored to the variable yet, so getting it is an error and nothing after it is reached, until
+            // a store gives the variable a type and this is visited again
+            std::optional<ValueType> var_type = var_types[inst.arg.value().get_int()];
+            if (!var_type.has_value())
+                state.reached = false;
+            state.push(var_type.value_or(TYPE_UNKNOWN));
+            return true;
+        }
+        case InstructionType::INST_AT:
+            state.pop(2);
+            state.push(ValueType::TYPE_CHAR);
+            return depth >= 2 && top == ValueType::TYPE_STR && second == ValueType::TYPE_INT;
+        case InstructionType::INST_LEN:
+            state.pop(1);
+            state.push(ValueType::TYPE_INT);
+            return depth >= 1 && top == ValueType::TYPE_STR;
+        case InstructionType::INST_TYPE:
+            state.pop(1);
+            state.push(ValueType::TYPE_VALTYPE);
+            return depth >= 1;
+        case InstructionType::INST_CONVERT:
+            state.pop(2);
+            state.push(TYPE_UNKNOWN);
+            return depth >= 2 && top == ValueType::TYPE_VALTYPE;
+        case InstructionType::INST_COND:{
+            ValueType cond = state.type_at(2);
+            state.pop(3);
+            state.push(top == second ? top : TYPE_UNKNOWN);
+            return depth >= 3 && is_integral(cond);
+        }
+        case InstructionType::INST_INC_VAR:{
+            ValueType var_type = var_types[inst.aux].value_or(TYPE_UNKNOWN);
+            return var_type == inst.arg.value().get_type() && is_numeric(var_type);
+        }
+        case InstructionType::INST_ADD_IMM:{
+            ValueType imm_type = inst.arg.value().get_type();
+            state.pop(1);
+            state.push(known_type(top, imm_type, is_numeric));
+            return depth >= 1 && top == imm_type && is_numeric(top);
+        }
+        default:
+            state.pop(depth);
+            return false;
+    }
+}
+
+// returns the instructions that can run after the given one
+static void successors(const std::vector<Instruction>& instructions, size_t index, const std::vector<size_t>& return_addrs, std::vector<size_t>& out){
+    const Instruction& inst = instructions[index];
+    out.clear();
+    switch (inst.op_code){
+        case InstructionType::INST_RET:
+            out = return_addrs;
+            return;
+        case InstructionType::INST_JUMP:
+        case InstructionType::INST_CALL:
+            break;
+        default:
+            out.push_back(index + 1);
+            break;
+    }
+    if (is_jump(inst.op_code))
+        out.push_back(static_cast<size_t>(inst.arg.value().get_int()));
+}
+
+/*
+    runs the analysis to a fixed point, widening the type of each variable as values are stored to it. when a
+    variable's type widens, every reached instruction that reads it is queued again, so the stack states and the
+    variable types settle together in a single pass
+*/
+static void analyze(const std::vector<Instruction>& instructions, const StackState& entry, const std::vector<size_t>& return_addrs,
+                    const std::vector<std::vector<size_t>>& readers, std::vector<StackState>& states, VarTypes& var_types){
+    size_t inst_count = instructions.size();
+    states.assign(inst_count, StackState());
+    std::vector<size_t> worklist;
+    std::vector<bool> queued(inst_count, false);
+    std::vector<size_t> next;
+    states[0].merge(entry);
+    worklist.push_back(0);
+    queued[0] = true;
+    while (!worklist.empty()){
+        size_t index = worklist.back();
+        worklist.pop_back();
+        queued[index] = false;
+        const Instruction& inst = instructions[index];
+        StackState state = states[index];
+        if (inst.op_code == InstructionType::INST_SET){
+            int slot = inst.arg.value().get_int();
+            std::optional<ValueType> stored = merge_type(var_types[slot], state.type_at(0));
+            if (stored != var_types[slot]){
+                var_types[slot] = stored;
+                for (size_t reader : readers[slot]){
+                    if (states[reader].reached && !queued[reader]){
+                        worklist.push_back(reader);
+                        queued[reader] = true;
+                    }
+                }
+            }
+        }
+        apply_inst(inst, state, var_types);
+        if (!state.reached)
+            continue;
+        successors(instructions, index, return_addrs, next);
+        for (size_t target : next){
+            // jumping to the end of the program halts it
+            if (target >= inst_count)
+                continue;
+            if (states[target].merge(state) && !queued[target]){
+                worklist.push_back(target);
+                queued[target] = true;
+            }
+        }
+    }
+}
+
+void verify_bytecode(std::vector<Instruction>& instructions, size_t entry_depth){
+    if (instructions.empty())
+        return;
+    // a return goes to the instruction after any call, or to the second instruction if the call stack is empty
+    std::vector<size_t> return_addrs {1};
+    // the instructions that read each variable slot
+    std::vector<std::vector<size_t>> readers;
+    for (size_t i = 0; i < instructions.size(); i++){
+        const Instruction& inst = instructions[i];
+        if (inst.op_code == InstructionType::INST_CALL)
+            return_addrs.push_back(i + 1);
+        size_t slot;
+        if (inst.op_code == InstructionType::INST_GET || inst.op_code == InstructionType::INST_SET)
+            slot = inst.arg.value().get_int();
+        else if (inst.op_code == InstructionType::INST_INC_VAR)
+            slot = inst.aux;
+        else
+            continue;
+        if (slot >= readers.size())
+            readers.resize(slot + 1);
+        if (inst.op_code != InstructionType::INST_SET)
+            readers[slot].push_back(i);
+    }
+    StackState entry;
+    entry.reached = true;
+    entry.depth = entry_depth;
+    /*
+        the type of a variable depends on the types stored to it, which in turn can depend on the types of variables.
+        variables start with no type at all, as a variable can't be read before something is stored to it, and a
+        variable's type only widens, from no type to a known type to an unknown one. so each variable requeues its
+        readers at most twice, and the analysis does at most two extra visits per read on top of the usual fixed point
+    */
+    VarTypes var_types(readers.size());
+    std::vector<StackState> states;
+    analyze(instructions, entry, return_addrs, readers, states, var_types);
+    for (size_t i = 0; i < instructions.size(); i++){
+        StackState state = states[i];
+        instructions[i].verified = state.reached && apply_inst(instructions[i], state, var_types);
+    }
+}